@@ -0,0 +1,130 @@
+#include "RTCP.h"
+
+#include <arpa/inet.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+
+namespace {
+constexpr uint8_t kSR = 200;
+constexpr uint8_t kRR = 201;
+constexpr uint8_t kSDES = 202;
+constexpr uint8_t kBYE = 203;
+constexpr uint8_t kRTPFB = 205;
+constexpr uint8_t kFmtNack = 1;
+// 1900 年到 1970 年的秒数
+constexpr uint64_t kNtpOffset = 2208988800ull;
+
+void put32(uint8_t* p, uint32_t value) {
+  value = htonl(value);
+  memcpy(p, &value, 4);
+}
+uint32_t get32(const uint8_t* p) {
+  uint32_t value;
+  memcpy(&value, p, 4);
+  return ntohl(value);
+}
+
+void parseReportBlocks(const uint8_t* p, size_t count,
+                       RTCPFeedback& feedback) {
+  for (size_t i = 0; i < count; ++i, p += 24) {
+    RTCPReportBlock block;
+    block.ssrc = get32(p);
+    block.fraction_lost = p[4];
+    // 24 位有符号数
+    int32_t lost = (p[5] << 16) | (p[6] << 8) | p[7];
+    if (lost & 0x800000) {
+      lost -= 0x1000000;
+    }
+    block.cumulative_lost = lost;
+    block.highest_seq = get32(p + 8);
+    block.jitter = get32(p + 12);
+    block.lsr = get32(p + 16);
+    block.dlsr = get32(p + 20);
+    feedback.reports.push_back(block);
+  }
+}
+
+void parseNack(const uint8_t* p, size_t length, RTCPFeedback& feedback) {
+  uint32_t media_ssrc = get32(p + 8);
+  for (size_t offset = 12; offset + 4 <= length; offset += 4) {
+    uint16_t pid = (p[offset] << 8) | p[offset + 1];
+    uint16_t blp = (p[offset + 2] << 8) | p[offset + 3];
+    feedback.nacks.push_back({media_ssrc, pid});
+    for (int i = 0; i < 16; ++i) {
+      if (blp & (1 << i)) {
+        feedback.nacks.push_back(
+            {media_ssrc, static_cast<uint16_t>(pid + i + 1)});
+      }
+    }
+  }
+}
+}  // namespace
+
+uint64_t ntpNow() {
+  auto since_epoch = std::chrono::system_clock::now().time_since_epoch();
+  auto us =
+      std::chrono::duration_cast<std::chrono::microseconds>(since_epoch)
+          .count();
+  uint64_t seconds = us / 1000000 + kNtpOffset;
+  uint64_t fraction = (static_cast<uint64_t>(us % 1000000) << 32) / 1000000;
+  return (seconds << 32) | fraction;
+}
+
+size_t buildSenderReport(const RTCPSenderInfo& info, const std::string& cname,
+                         uint8_t* out, size_t capacity) {
+  // SDES：头 4 + SSRC 4 + CNAME 项(2 + 长度) + 结束符，按 4 字节对齐
+  size_t cname_len = std::min<size_t>(cname.size(), 255);
+  size_t sdes_size = (4 + 4 + 2 + cname_len + 1 + 3) / 4 * 4;
+  size_t total = 28 + sdes_size;
+  if (capacity < total) {
+    return 0;
+  }
+  memset(out, 0, total);
+
+  // SR，不带报告块
+  put32(out, (0x80u << 24) | (kSR << 16) | (28 / 4 - 1));
+  put32(out + 4, info.ssrc);
+  put32(out + 8, static_cast<uint32_t>(info.ntp_time >> 32));
+  put32(out + 12, static_cast<uint32_t>(info.ntp_time));
+  put32(out + 16, info.rtp_timestamp);
+  put32(out + 20, info.packet_count);
+  put32(out + 24, info.octet_count);
+
+  // SDES，一个 chunk，只有 CNAME
+  uint8_t* sdes = out + 28;
+  put32(sdes, (0x81u << 24) | (kSDES << 16) |
+                  static_cast<uint32_t>(sdes_size / 4 - 1));
+  put32(sdes + 4, info.ssrc);
+  sdes[8] = 1;  // CNAME
+  sdes[9] = static_cast<uint8_t>(cname_len);
+  memcpy(sdes + 10, cname.data(), cname_len);
+  return total;
+}
+
+bool parseRTCP(const uint8_t* data, size_t size, RTCPFeedback& feedback) {
+  feedback.clear();
+  while (size >= 4) {
+    uint8_t version = data[0] >> 6;
+    uint8_t count = data[0] & 0x1F;
+    uint8_t type = data[1];
+    size_t length = ((data[2] << 8) | data[3]) * 4 + 4;
+    if (version != 2 || length > size) {
+      return false;
+    }
+    if (type == kRR && length >= 8 + count * 24u) {
+      parseReportBlocks(data + 8, count, feedback);
+    } else if (type == kSR && length >= 28 + count * 24u) {
+      parseReportBlocks(data + 28, count, feedback);
+    } else if (type == kRTPFB && count == kFmtNack && length >= 12) {
+      // RTPFB 中 count 位置是 FMT
+      parseNack(data, length, feedback);
+    } else if (type == kBYE) {
+      feedback.bye = true;
+    }
+    data += length;
+    size -= length;
+  }
+  return true;
+}
@@ -0,0 +1,80 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/*
+ * RTCP SR (RFC 3550 6.4.1)
+ *    0                   1                   2                   3
+ *    0 1 2 3 4 5 6 7 8 9 0 1 2 3 4 5 6 7 8 9 0 1 2 3 4 5 6 7 8 9 0 1
+ *   +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
+ *   |V=2|P|    RC   |   PT=SR=200   |             length            |
+ *   +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
+ *   |                         SSRC of sender                        |
+ *   +=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+
+ *   |              NTP timestamp, most significant word             |
+ *   +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
+ *   |             NTP timestamp, least significant word             |
+ *   +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
+ *   |                         RTP timestamp                         |
+ *   +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
+ *   |                     sender's packet count                     |
+ *   +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
+ *   |                      sender's octet count                     |
+ *   +=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+
+ */
+
+// 当前时间的 64 位 NTP 时间戳（高 32 位秒，低 32 位小数）
+uint64_t ntpNow();
+
+struct RTCPSenderInfo {
+  uint32_t ssrc = 0;
+  uint64_t ntp_time = 0;
+  uint32_t rtp_timestamp = 0;  // 与 ntp_time 同一时刻的 RTP 时间戳
+  uint32_t packet_count = 0;
+  uint32_t octet_count = 0;
+};
+
+// 接收端报告块（RR 或 SR 中携带）
+struct RTCPReportBlock {
+  uint32_t ssrc = 0;
+  uint8_t fraction_lost = 0;  // 上个报告周期的丢包率，单位 1/256
+  int32_t cumulative_lost = 0;
+  uint32_t highest_seq = 0;
+  uint32_t jitter = 0;  // 到达间隔抖动，单位为 RTP 时钟
+  uint32_t lsr = 0;     // 最近一次 SR 的 NTP 时间戳中间 32 位
+  uint32_t dlsr = 0;    // 从收到该 SR 到发出本报告的延迟，单位 1/65536 秒
+};
+
+/*
+ * Generic NACK (RFC 4585 6.2.1)，RTPFB(PT=205)，FMT=1，FCI 可以有多个：
+ *    0                   1                   2                   3
+ *    0 1 2 3 4 5 6 7 8 9 0 1 2 3 4 5 6 7 8 9 0 1 2 3 4 5 6 7 8 9 0 1
+ *   +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
+ *   |            PID                |             BLP               |
+ *   +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
+ * PID 为丢失的序号，BLP 的第 i 位表示 PID + i + 1 也丢了
+ */
+struct RTCPNack {
+  uint32_t media_ssrc = 0;  // 被请求重传的流
+  uint16_t seq = 0;
+};
+
+// 解析一个复合 RTCP 包的结果，复用以避免每次分配
+struct RTCPFeedback {
+  std::vector<RTCPReportBlock> reports;
+  std::vector<RTCPNack> nacks;  // 已按 BLP 展开成单个序号
+  bool bye = false;
+  void clear() {
+    reports.clear();
+    nacks.clear();
+    bye = false;
+  }
+};
+
+// 写出 SR + SDES(CNAME) 组成的复合包，返回长度；out 空间不够时返回 0
+size_t buildSenderReport(const RTCPSenderInfo& info, const std::string& cname,
+                         uint8_t* out, size_t capacity);
+// 解析客户端发来的复合 RTCP 包，格式错误返回 false
+bool parseRTCP(const uint8_t* data, size_t size, RTCPFeedback& feedback);
@@ -1,10 +1,10 @@
 #include "RTP.h"
 
-RTPPacket::RTPPacket(uint8_t payload_type, uint16_t seq, uint32_t timestamp,
-                     uint32_t ssrc, bool marker) {
-  // 12 byte 的header
-  header_.resize(12);
+#include <algorithm>
 
+RTPPacket::RTPPacket(uint8_t payload_type, uint16_t seq, uint32_t timestamp,
+                     uint32_t ssrc, bool marker)
+    : header_size_(kRTPHeaderSize) {
   // Byte 0: V=2(10), P=0, X=0, CC=0 -> 10000000 -> 0x80
   header_[0] = 0x80;
 
@@ -25,13 +25,337 @@ RTPPacket::RTPPacket(uint8_t payload_type, uint16_t seq, uint32_t timestamp,
   memcpy(&header_[8], &ssrc_n, 4);
 }
 
-void RTPPacket::setPayload(const uint8_t* data, size_t size) {
-  payload_.assign(data, data + size);
+void H264Packetizer::packetize(const std::vector<NaluView>& nalus,
+                               uint32_t timestamp,
+                               std::vector<RTPPacket>& out) {
+  for (size_t i = 0; i < nalus.size();) {
+    // SPS、PPS、SEI 和小的 slice 尽量合成一个 STAP-A
+    size_t count = aggregate(nalus, i, timestamp, out);
+    if (count > 0) {
+      i += count;
+      continue;
+    }
+    packetizeNalu(nalus[i], timestamp, i + 1 == nalus.size(), out);
+    ++i;
+  }
+}
+
+size_t H264Packetizer::aggregate(const std::vector<NaluView>& nalus,
+                                 size_t first, uint32_t timestamp,
+                                 std::vector<RTPPacket>& out) {
+  //*  0                   1                   2                   3
+  //*  0 1 2 3 4 5 6 7 8 9 0 1 2 3 4 5 6 7 8 9 0 1 2 3 4 5 6 7 8 9 0 1
+  //* +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
+  //* |STAP-A NAL HDR |         NALU 1 Size           | NALU 1 HDR    |
+  //* +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
+  //* |                         NALU 1 Data                           |
+  //* :                                                               :
+  //* +               +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
+  //* |               | NALU 2 Size                   | NALU 2 HDR    |
+  //* +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
+  // 先数出能放进一个包的 NALU 个数
+  size_t count = 0;
+  size_t bytes = 1;
+  uint8_t forbidden = 0;
+  uint8_t nri = 0;  // 取被聚合 NALU 中最大的 NRI
+  while (first + count < nalus.size() && count < RTPPacket::kMaxSegments) {
+    const NaluView& nalu = nalus[first + count];
+    if (bytes + 2 + nalu.size > kMaxPayloadSize) {
+      break;
+    }
+    bytes += 2 + nalu.size;
+    forbidden |= nalu.data[0] & 0x80;
+    nri = std::max<uint8_t>(nri, nalu.data[0] & 0x60);
+    ++count;
+  }
+  if (count < 2) {
+    return 0;
+  }
+
+  bool last = first + count == nalus.size();
+  RTPPacket packet = makePacket(timestamp, last);
+  packet.appendHeader(forbidden | nri | 24);
+  for (size_t i = 0; i < count; ++i) {
+    const NaluView& nalu = nalus[first + i];
+    packet.appendHeader(static_cast<uint8_t>(nalu.size >> 8));
+    packet.appendHeader(static_cast<uint8_t>(nalu.size & 0xFF));
+    packet.appendPayload(nalu.data, nalu.size);
+  }
+  out.push_back(packet);
+  return count;
 }
 
-// 获取完整数据包，用于 sendto
-std::vector<uint8_t> RTPPacket::getBuffer() {
-  std::vector<uint8_t> buffer = header_;
-  buffer.insert(buffer.end(), payload_.begin(), payload_.end());
-  return buffer;
-}
\ No newline at end of file
+// 起始码不参与发送
+void H264Packetizer::packetizeNalu(const NaluView& nalu, uint32_t timestamp,
+                                   bool last, std::vector<RTPPacket>& out) {
+  if (nalu.empty()) {
+    return;
+  }
+  // 判断是否需要分片
+  if (nalu.size <= kMaxPayloadSize) {
+    //*   0 1 2 3 4 5 6 7 8 9
+    //*  +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
+    //*  |F|NRI|  Type   | a single NAL unit ... |
+    //*  +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
+    // F : 禁止位，0。
+    // NRI: 重要性指示。比如 IDR 帧是 11 (3)，普通 P 帧是 10 (2)。
+    // Type: 原始类型。比如 5 代表 IDR，7 代表 SPS
+    RTPPacket packet = makePacket(timestamp, last);
+    packet.setPayload(nalu.data, nalu.size);
+    out.push_back(packet);
+    return;
+  }
+
+  // 拆分原来的NALU头，将信息重组为FU indicator和FU Header
+  //*  0                   1                   2
+  //*  0 1 2 3 4 5 6 7 8 9 0 1 2 3 4 5 6 7 8 9 0 1 2 3
+  //* +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
+  //* | FU indicator  |   FU header   |   FU payload   ...  |
+  //* +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
+
+  //*     FU Indicator
+  //*    0 1 2 3 4 5 6 7
+  //*   +-+-+-+-+-+-+-+-+
+  //*   |F|NRI|  Type   |
+  //*   +---------------+
+  // F和NRI和原始NALU头一致
+  // type改为28，28 在 H.264 标准里是 FU-A 分片单元
+
+  //*      FU Header
+  //*    0 1 2 3 4 5 6 7
+  //*   +-+-+-+-+-+-+-+-+
+  //*   |S|E|R|  Type   |
+  //*   +---------------+
+  // S (Start bit): 开始位。如果是分片的第一个包，置 1；否则置 0。
+  // E (End bit): 结束位。如果是分片的最后一个包，置 1；否则置 0。
+  // R (Reserved): 保留位，必须是 0。
+  // type与NALU头一致
+
+  uint8_t nalu_header = nalu.data[0];
+  uint8_t nri = nalu_header & 0x60;   // 与上0110 0000以保留NRI
+  uint8_t type = nalu_header & 0x1F;  // 与上0001 1111以保留NALU Type
+
+  // 去掉 NALU 头，只切分数据部分
+  const uint8_t* nalu_payload = nalu.data + 1;
+  size_t nalu_payload_size = nalu.size - 1;
+  size_t offset = 0;
+
+  // FU Indicator: 或上0001 1100，相当于直接把28加在低位，高三位还是F和NRI
+  uint8_t fu_indicator = nri | 28;
+
+  while (offset < nalu_payload_size) {
+    // 计算当前分片大小（FU indicator 和 FU header 占 2 字节）
+    size_t chunk_size =
+        std::min(kMaxPayloadSize - 2, nalu_payload_size - offset);
+
+    bool is_start_chunk = (offset == 0);
+    bool is_last_chunk = (offset + chunk_size >= nalu_payload_size);
+
+    // FU Header: S(Start), E(End), R(0), Type(原NALU Type)
+    uint8_t fu_header = type;
+    if (is_start_chunk) {
+      fu_header |= 0x80;  // Set S bit
+    } else if (is_last_chunk) {
+      fu_header |= 0x40;  // Set E bit
+    }
+
+    // Marker 位：只有整个帧的最后一个包才置为 true
+    RTPPacket packet = makePacket(timestamp, last && is_last_chunk);
+    packet.appendHeader(fu_indicator);
+    packet.appendHeader(fu_header);
+    packet.setPayload(nalu_payload + offset, chunk_size);
+    out.push_back(packet);
+
+    offset += chunk_size;
+  }
+}
+
+namespace {
+// H.265 NALU 头第一个字节的 bit1~6
+uint8_t h265Type(const NaluView& nalu) { return (nalu.data[0] >> 1) & 0x3F; }
+bool isH265ParameterSet(const NaluView& nalu) {
+  uint8_t type = h265Type(nalu);
+  return type >= 32 && type <= 34;  // VPS/SPS/PPS
+}
+}  // namespace
+
+void H265Packetizer::packetize(const std::vector<NaluView>& nalus,
+                               uint32_t timestamp,
+                               std::vector<RTPPacket>& out) {
+  for (size_t i = 0; i < nalus.size();) {
+    if (nalus[i].size < 2) {
+      ++i;
+      continue;
+    }
+    size_t count = aggregate(nalus, i, timestamp, out);
+    if (count > 0) {
+      i += count;
+      continue;
+    }
+    packetizeNalu(nalus[i], timestamp, i + 1 == nalus.size(), out);
+    ++i;
+  }
+}
+
+size_t H265Packetizer::aggregate(const std::vector<NaluView>& nalus,
+                                 size_t first, uint32_t timestamp,
+                                 std::vector<RTPPacket>& out) {
+  //*  0                   1                   2                   3
+  //*  0 1 2 3 4 5 6 7 8 9 0 1 2 3 4 5 6 7 8 9 0 1 2 3 4 5 6 7 8 9 0 1
+  //* +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
+  //* |    PayloadHdr (Type=48)       |         NALU 1 Size           |
+  //* +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
+  //* |          NALU 1 HDR           |         NALU 1 Data   ...     |
+  //* +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
+  //* |         NALU 2 Size           |   NALU 2 HDR  ...             |
+  //* +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
+  // 先数出能放进一个包的参数集个数
+  size_t count = 0;
+  size_t bytes = 2;
+  uint8_t forbidden = 0;
+  while (first + count < nalus.size() && count < RTPPacket::kMaxSegments) {
+    const NaluView& nalu = nalus[first + count];
+    if (nalu.size < 2 || !isH265ParameterSet(nalu) ||
+        bytes + 2 + nalu.size > kMaxPayloadSize) {
+      break;
+    }
+    bytes += 2 + nalu.size;
+    forbidden |= nalu.data[0] & 0x80;
+    ++count;
+  }
+  if (count < 2) {
+    return 0;
+  }
+  // PayloadHdr 的 LayerId 和 TID 取所有被聚合 NALU 中的最小值
+  uint8_t layer_id = 0x3F;
+  uint8_t tid = 0x07;
+  for (size_t i = 0; i < count; ++i) {
+    const NaluView& nalu = nalus[first + i];
+    layer_id = std::min<uint8_t>(
+        layer_id, ((nalu.data[0] & 0x01) << 5) | (nalu.data[1] >> 3));
+    tid = std::min<uint8_t>(tid, nalu.data[1] & 0x07);
+  }
+
+  bool last = first + count == nalus.size();
+  RTPPacket packet = makePacket(timestamp, last);
+  packet.appendHeader(forbidden | (48 << 1) | (layer_id >> 5));
+  packet.appendHeader(((layer_id & 0x1F) << 3) | tid);
+  for (size_t i = 0; i < count; ++i) {
+    const NaluView& nalu = nalus[first + i];
+    packet.appendHeader(static_cast<uint8_t>(nalu.size >> 8));
+    packet.appendHeader(static_cast<uint8_t>(nalu.size & 0xFF));
+    packet.appendPayload(nalu.data, nalu.size);
+  }
+  out.push_back(packet);
+  return count;
+}
+
+void H265Packetizer::packetizeNalu(const NaluView& nalu, uint32_t timestamp,
+                                   bool last, std::vector<RTPPacket>& out) {
+  if (nalu.size <= kMaxPayloadSize) {
+    RTPPacket packet = makePacket(timestamp, last);
+    packet.setPayload(nalu.data, nalu.size);
+    out.push_back(packet);
+    return;
+  }
+
+  //*  0                   1                   2                   3
+  //*  0 1 2 3 4 5 6 7 8 9 0 1 2 3 4 5 6 7 8 9 0 1 2 3 4 5 6 7 8 9 0 1
+  //* +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
+  //* |    PayloadHdr (Type=49)       |   FU header   | DONL (cond)   |
+  //* +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
+  //*      FU header
+  //*    +---------------+
+  //*    |0|1|2|3|4|5|6|7|
+  //*    +-+-+-+-+-+-+-+-+
+  //*    |S|E|  FuType   |
+  //*    +---------------+
+  // PayloadHdr 与原 NALU 头相同，只把 Type 换成 49；FuType 为原来的 Type
+  uint8_t type = h265Type(nalu);
+  uint8_t payload_hdr0 = (nalu.data[0] & 0x81) | (49 << 1);
+  uint8_t payload_hdr1 = nalu.data[1];
+
+  // 去掉 2 字节 NALU 头，只切分数据部分
+  const uint8_t* nalu_payload = nalu.data + 2;
+  size_t nalu_payload_size = nalu.size - 2;
+  size_t offset = 0;
+  while (offset < nalu_payload_size) {
+    size_t chunk_size =
+        std::min(kMaxPayloadSize - 3, nalu_payload_size - offset);
+    bool is_start_chunk = (offset == 0);
+    bool is_last_chunk = (offset + chunk_size >= nalu_payload_size);
+
+    uint8_t fu_header = type;
+    if (is_start_chunk) {
+      fu_header |= 0x80;
+    } else if (is_last_chunk) {
+      fu_header |= 0x40;
+    }
+
+    RTPPacket packet = makePacket(timestamp, last && is_last_chunk);
+    packet.appendHeader(payload_hdr0);
+    packet.appendHeader(payload_hdr1);
+    packet.appendHeader(fu_header);
+    packet.appendPayload(nalu_payload + offset, chunk_size);
+    out.push_back(packet);
+
+    offset += chunk_size;
+  }
+}
+
+void AACPacketizer::packetize(const std::vector<NaluView>& nalus,
+                              uint32_t timestamp,
+                              std::vector<RTPPacket>& out) {
+  // 每个 AU 单独成包，Marker 表示 AU 的最后一片（RFC 3640 3.2.1）
+  for (const NaluView& au : nalus) {
+    // AU-header 中的长度只有 13 位
+    if (au.size >= (1 << 13)) {
+      continue;
+    }
+    size_t offset = 0;
+    while (offset < au.size) {
+      size_t chunk = std::min(au.size - offset, kMaxPayloadSize - 4);
+      bool last = offset + chunk == au.size;
+      RTPPacket packet = makePacket(timestamp, last);
+      // AU-headers-length 以位为单位：一个 16 位的 AU-header
+      packet.appendHeader(0x00);
+      packet.appendHeader(0x10);
+      packet.appendHeader(static_cast<uint8_t>(au.size >> 5));
+      packet.appendHeader(static_cast<uint8_t>((au.size & 0x1F) << 3));
+      packet.appendPayload(au.data + offset, chunk);
+      out.push_back(packet);
+      offset += chunk;
+    }
+  }
+}
+
+void G711Packetizer::packetize(const std::vector<NaluView>& nalus,
+                               uint32_t timestamp,
+                               std::vector<RTPPacket>& out) {
+  // 同一次调用的采样是连续的，后面的包时间戳按已发送的采样数推算
+  for (const NaluView& frame : nalus) {
+    for (size_t offset = 0; offset < frame.size; offset += kMaxPayloadSize) {
+      size_t chunk = std::min(frame.size - offset, kMaxPayloadSize);
+      RTPPacket packet = makePacket(timestamp, false);
+      packet.setPayload(frame.data + offset, chunk);
+      out.push_back(packet);
+      timestamp += static_cast<uint32_t>(chunk);
+    }
+  }
+}
+
+std::unique_ptr<RTPPacketizer> makePacketizer(CodecId codec,
+                                              uint8_t payload_type,
+                                              uint32_t ssrc) {
+  switch (codec) {
+    case CodecId::H265:
+      return std::make_unique<H265Packetizer>(payload_type, ssrc);
+    case CodecId::AAC:
+      return std::make_unique<AACPacketizer>(payload_type, ssrc);
+    case CodecId::PCMA:
+    case CodecId::PCMU:
+      return std::make_unique<G711Packetizer>(payload_type, ssrc);
+    default:
+      return std::make_unique<H264Packetizer>(payload_type, ssrc);
+  }
+}
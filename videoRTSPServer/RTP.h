@@ -2,8 +2,14 @@
 #include <arpa/inet.h>
 
 #include <cstdint>
+#include <array>
+#include <boost/asio/buffer.hpp>
 #include <cstring>
+#include <memory>
 #include <vector>
+
+#include "global.h"
+#include "mediafile.h"
 /*
  *    0                   1                   2                   3
  *    7 6 5 4 3 2 1 0|7 6 5 4 3 2 1 0|7 6 5 4 3 2 1 0|7 6 5 4 3 2 1 0
@@ -37,17 +43,181 @@
 //   uint32_t ssrc;
 // };
 
+// 一个待发送的 RTP 包
+// 12 字节 RTP 头和 FU indicator/FU header 这类前缀直接存在包内的小数组里，
+// 负载只记录指针，指向 NALU 所在的内存（由 MediaSource 持有），发送时不做拷贝
+// 聚合包（STAP-A、H.265 AP）有多段负载，每段前面的长度字段同样存在包内
 class RTPPacket {
  public:
+  static constexpr size_t kRTPHeaderSize = 12;
+  // RTP 头之后最多还有 12 字节前缀，够放聚合包的包头和每段的 2 字节长度
+  static constexpr size_t kMaxHeaderSize = 24;
+  // 单个 NALU 或分片只有一段负载，聚合包每个 NALU 一段
+  static constexpr size_t kMaxSegments = 4;
+  static constexpr size_t kMaxBuffers = kMaxSegments * 2;
+
+  // 分散缓冲区：前缀与各段负载交替排列，可直接用于 send_to / async_write
+  struct BufferList {
+    using value_type = boost::asio::const_buffer;
+    using const_iterator = const boost::asio::const_buffer*;
+    std::array<boost::asio::const_buffer, kMaxBuffers> items;
+    size_t count = 0;
+    const_iterator begin() const { return items.data(); }
+    const_iterator end() const { return items.data() + count; }
+  };
+
+  RTPPacket() = default;
   RTPPacket(uint8_t payload_type, uint16_t seq, uint32_t timestamp,
             uint32_t ssrc, bool marker);
 
-  void setPayload(const uint8_t* data, size_t size);
+  // 在已有内容之后追加一个前缀字节（FU indicator、FU header、聚合包的长度等）
+  void appendHeader(uint8_t byte) { header_[header_size_++] = byte; }
+  // 追加一段负载，只记录位置，调用者保证发送完成前这块内存有效
+  // 此前 appendHeader 写入、尚未归属的字节作为这段的前缀
+  void appendPayload(const uint8_t* data, size_t size) {
+    segments_[segment_count_++] = {data, static_cast<uint32_t>(size),
+                                   header_size_};
+    payload_size_ += static_cast<uint32_t>(size);
+  }
+  void setPayload(const uint8_t* data, size_t size) {
+    segment_count_ = 0;
+    payload_size_ = 0;
+    appendPayload(data, size);
+  }
+  // 还能否再追加一段带 prefix_size 字节前缀的负载
+  bool canAppend(size_t prefix_size) const {
+    return segment_count_ < kMaxSegments &&
+           header_size_ + prefix_size <= kMaxHeaderSize;
+  }
 
-  // 获取完整数据包，用于 sendto
-  std::vector<uint8_t> getBuffer();
+  uint16_t seq() const { return ntohs(load<uint16_t>(2)); }
+  uint32_t timestamp() const { return ntohl(load<uint32_t>(4)); }
+  uint32_t ssrc() const { return ntohl(load<uint32_t>(8)); }
+  bool marker() const { return header_[1] & 0x80; }
+  // 转发同一份包给不同接收者时改写包头，负载不变
+  void setSeq(uint16_t seq) { store<uint16_t>(2, htons(seq)); }
+  void setTimestamp(uint32_t timestamp) { store<uint32_t>(4, htonl(timestamp)); }
+  void setSsrc(uint32_t ssrc) { store<uint32_t>(8, htonl(ssrc)); }
+
+  // 用于 send_to / async_send_to 的分散缓冲区，底层走 sendmsg 的 iovec
+  BufferList buffers() const {
+    BufferList list;
+    uint8_t prefix_begin = 0;
+    for (uint8_t i = 0; i < segment_count_; ++i) {
+      const Segment& segment = segments_[i];
+      list.items[list.count++] = boost::asio::const_buffer(
+          header_.data() + prefix_begin, segment.prefix_end - prefix_begin);
+      list.items[list.count++] =
+          boost::asio::const_buffer(segment.data, segment.size);
+      prefix_begin = segment.prefix_end;
+    }
+    return list;
+  }
+  size_t size() const { return header_size_ + payload_size_; }
 
  private:
-  std::vector<uint8_t> header_;
-  std::vector<uint8_t> payload_;
-};
\ No newline at end of file
+  struct Segment {
+    const uint8_t* data;
+    uint32_t size;
+    uint8_t prefix_end;  // 这段负载的前缀在 header_ 中的结束位置
+  };
+
+  template <typename T>
+  T load(size_t offset) const {
+    T value;
+    memcpy(&value, &header_[offset], sizeof(T));
+    return value;
+  }
+  template <typename T>
+  void store(size_t offset, T value) {
+    memcpy(&header_[offset], &value, sizeof(T));
+  }
+
+  std::array<uint8_t, kMaxHeaderSize> header_;
+  uint8_t header_size_ = 0;
+  uint8_t segment_count_ = 0;
+  uint32_t payload_size_ = 0;
+  std::array<Segment, kMaxSegments> segments_;
+};
+
+// 负责把一帧的 NALU 打成若干 RTP 包，维护序号
+// 各编码的打包器共用这个接口，按挂载点的编码选择
+class RTPPacketizer {
+ public:
+  RTPPacketizer(uint8_t payload_type, uint32_t ssrc)
+      : payload_type_(payload_type), ssrc_(ssrc) {}
+  virtual ~RTPPacketizer() = default;
+  // 一帧（访问单元）的打包结果追加到 out，只有最后一个包带 Marker
+  virtual void packetize(const std::vector<NaluView>& nalus,
+                         uint32_t timestamp, std::vector<RTPPacket>& out) = 0;
+  uint16_t seq() const { return seq_; }
+  uint32_t ssrc() const { return ssrc_; }
+
+ protected:
+  RTPPacket makePacket(uint32_t timestamp, bool marker) {
+    return RTPPacket(payload_type_, seq_++, timestamp, ssrc_, marker);
+  }
+
+  // 限制包大小, MTU通常为1500
+  static constexpr size_t kMaxPayloadSize = 1400;
+  uint8_t payload_type_;
+  uint32_t ssrc_;
+  uint16_t seq_ = 0;
+};
+
+// RFC 6184：小 NALU 单包发送，大 NALU 用 FU-A 分片，
+// 同一帧中相邻的小 NALU 合成 STAP-A（packetization-mode=1 允许）
+class H264Packetizer : public RTPPacketizer {
+ public:
+  using RTPPacketizer::RTPPacketizer;
+  void packetize(const std::vector<NaluView>& nalus, uint32_t timestamp,
+                 std::vector<RTPPacket>& out) override;
+
+ private:
+  // last 表示这是该帧的最后一个 NALU，决定 Marker 位
+  void packetizeNalu(const NaluView& nalu, uint32_t timestamp, bool last,
+                     std::vector<RTPPacket>& out);
+  // 从 nalus[first] 开始把能放进一个包的 NALU 合成 STAP-A，
+  // 返回聚合的个数，不足两个时返回 0
+  size_t aggregate(const std::vector<NaluView>& nalus, size_t first,
+                   uint32_t timestamp, std::vector<RTPPacket>& out);
+};
+
+// H.265 打包（RFC 7798）：2 字节 NALU 头，大 NALU 用 FU（type 49）分片，
+// 连续的 VPS/SPS/PPS 合成一个聚合包（AP，type 48）
+class H265Packetizer : public RTPPacketizer {
+ public:
+  using RTPPacketizer::RTPPacketizer;
+  void packetize(const std::vector<NaluView>& nalus, uint32_t timestamp,
+                 std::vector<RTPPacket>& out) override;
+
+ private:
+  void packetizeNalu(const NaluView& nalu, uint32_t timestamp, bool last,
+                     std::vector<RTPPacket>& out);
+  // 从 nalus[first] 开始尽量聚合参数集，返回聚合的个数，不足两个时返回 0
+  size_t aggregate(const std::vector<NaluView>& nalus, size_t first,
+                   uint32_t timestamp, std::vector<RTPPacket>& out);
+};
+
+// AAC 打包（RFC 3640 AAC-hbr 模式）：负载前是 AU-headers-length 和每个 AU 的
+// AU-header（13 位长度 + 3 位 index），超过 MTU 的 AU 分片，每片都带完整 AU 的长度
+// nalus 中的每一项是一个 AU（去掉 ADTS 头的一帧）
+class AACPacketizer : public RTPPacketizer {
+ public:
+  using RTPPacketizer::RTPPacketizer;
+  void packetize(const std::vector<NaluView>& nalus, uint32_t timestamp,
+                 std::vector<RTPPacket>& out) override;
+};
+
+// G.711（RFC 3551 4.5.14）：负载就是采样本身，超过 MTU 时按字节切开
+class G711Packetizer : public RTPPacketizer {
+ public:
+  using RTPPacketizer::RTPPacketizer;
+  void packetize(const std::vector<NaluView>& nalus, uint32_t timestamp,
+                 std::vector<RTPPacket>& out) override;
+};
+
+// 按编码创建打包器
+std::unique_ptr<RTPPacketizer> makePacketizer(CodecId codec,
+                                              uint8_t payload_type,
+                                              uint32_t ssrc);
@@ -3,36 +3,60 @@
 #include <boost/system/detail/error_code.hpp>
 #include <iostream>
 #include <memory>
+#include <stdexcept>
 
 #include "asioioservicepool.h"
 #include "RTSPsession.h"
 
-RTSPServer::RTSPServer(net::io_context& ioc, uint16_t port)
-    : ioc_(ioc), acceptor_(ioc_, tcp::endpoint(tcp::v4(), port)) {}
+namespace {
+#ifdef SO_REUSEPORT
+using ReusePortOption = net::detail::socket_option::boolean<SOL_SOCKET, SO_REUSEPORT>;
+#endif
+}  // namespace
+
+RTSPServer::RTSPServer(net::io_context& ioc, uint16_t port, bool reuse_port)
+    : ioc_(ioc), acceptor_(ioc_), reuse_port_(reuse_port) {
+  tcp::endpoint endpoint(tcp::v4(), port);
+  acceptor_.open(endpoint.protocol());
+  acceptor_.set_option(tcp::acceptor::reuse_address(true));
+  if (reuse_port_) {
+#ifdef SO_REUSEPORT
+    acceptor_.set_option(ReusePortOption(true));
+#else
+    throw std::runtime_error("SO_REUSEPORT is not supported");
+#endif
+  }
+  acceptor_.bind(endpoint);
+  acceptor_.listen();
+}
 
 RTSPServer::~RTSPServer() {}
 
 void RTSPServer::start() {
-  
   auto self = shared_from_this();
-  auto& ioc = AsioIOServicePool::GetInstance()->GetIOService();
-  auto new_session = std::make_shared<RTSPSession>(ioc);
-  acceptor_.async_accept(
-      new_session->Socket(), [self, new_session](boost::system::error_code ec) {
-        try {
-          // 出错则放弃这个连接，继续监听新链接
-          if (ec) {
-            self->start();
-            return;
-          }
-          // 处理新链接，创建session管理新连接
-          std::cout << "新连接" << std::endl;
-          new_session->pickRequest();
-          // 继续监听
-          self->start();
-        } catch (std::exception& exp) {
-          std::cout << "exception is " << exp.what() << std::endl;
-          self->start();
-        }
-      });
-}
\ No newline at end of file
+  auto handler = [self](boost::system::error_code ec, tcp::socket socket) {
+    try {
+      // 出错则放弃这个连接，继续监听新链接
+      if (ec) {
+        self->start();
+        return;
+      }
+      // 处理新链接，创建session管理新连接，会话运行在套接字所在的 io_context 上
+      std::cout << "新连接" << std::endl;
+      std::make_shared<RTSPSession>(std::move(socket))->pickRequest();
+      // 继续监听
+      self->start();
+    } catch (std::exception& exp) {
+      std::cout << "exception is " << exp.what() << std::endl;
+      self->start();
+    }
+  };
+  if (reuse_port_) {
+    // 内核已经分好了线程，会话直接用接受它的 io_context
+    acceptor_.async_accept(std::move(handler));
+  } else {
+    // 接受的套接字直接建在负载最轻的 io_context 上
+    acceptor_.async_accept(AsioIOServicePool::GetInstance()->GetIOService(),
+                           std::move(handler));
+  }
+}
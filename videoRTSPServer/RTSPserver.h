@@ -7,7 +7,9 @@
 #include "threadpool.h"
 class RTSPServer : public std::enable_shared_from_this<RTSPServer> {
  public:
-  RTSPServer(net::io_context& ioc, uint16_t port);
+  // reuse_port 为 true 时以 SO_REUSEPORT 监听，同一端口可以有多个 RTSPServer，
+  // 由内核把新连接分给各个 io_context，会话就留在接受它的 io_context 上
+  RTSPServer(net::io_context& ioc, uint16_t port, bool reuse_port = false);
   ~RTSPServer();
   void start();
 
@@ -17,5 +19,6 @@ class RTSPServer : public std::enable_shared_from_this<RTSPServer> {
  private:
   net::io_context& ioc_;
   tcp::acceptor acceptor_;
+  bool reuse_port_;
   std::shared_ptr<ThreadPool> threadpool_ = ThreadPool::GetInstance();
 };
@@ -3,26 +3,77 @@
 #include <boost/asio/buffer.hpp>
 #include <boost/asio/io_context.hpp>
 #include <boost/system/detail/error_code.hpp>
+#include <charconv>
 #include <chrono>
 #include <cstdint>
 #include <iostream>
 #include <memory>
-#include <sstream>
 #include <string>
 #include <vector>
 
 #include "RTP.h"
+#include "config.h"
 #include "global.h"
+#include "mediacatalog.h"
 #include "mediafile.h"
+#include "portallocator.h"
+#include "sdp.h"
+#include "threadpool.h"
 
-int RTSPRequest::parseRequest(const std::string& req_str) {
-  std::stringstream ss(req_str);
-  std::string line;
-  bool is_requestLine = true;
+namespace {
+// 解析 "a-b" 形式的一对数字，比如 client_port=8000-8001、interleaved=0-1
+bool parseNumberPair(std::string_view value, unsigned& first,
+                     unsigned& second) {
+  const char* begin = value.data();
+  const char* end = value.data() + value.size();
+  auto result = std::from_chars(begin, end, first);
+  if (result.ec != std::errc() || result.ptr == end || *result.ptr != '-') {
+    return false;
+  }
+  result = std::from_chars(result.ptr + 1, end, second);
+  return result.ec == std::errc();
+}
+
+// 在 Transport 之类用 ; 分隔的参数中找 name=，返回 = 之后到 ; 为止的部分
+std::string_view findParameter(std::string_view value, std::string_view name) {
+  size_t pos = value.find(name);
+  if (pos == std::string_view::npos) {
+    return {};
+  }
+  value.remove_prefix(pos + name.size());
+  return value.substr(0, value.find(';'));
+}
+
+// SETUP 的 URL 末尾是 SDP 里 a=control 指定的轨道（如 .../track1），
+// 没有时按视频处理，格式不对返回 -1
+size_t trackFromUrl(std::string_view url) {
+  url = url.substr(0, url.find('?'));
+  while (!url.empty() && url.back() == '/') {
+    url.remove_suffix(1);
+  }
+  std::string_view last = url.substr(url.rfind('/') + 1);
+  if (last.substr(0, 5) != "track") {
+    return 0;
+  }
+  size_t index = 0;
+  auto result =
+      std::from_chars(last.data() + 5, last.data() + last.size(), index);
+  if (result.ec != std::errc() || result.ptr != last.data() + last.size()) {
+    return size_t(-1);
+  }
+  return index;
+}
+}  // namespace
 
-  while (std::getline(ss, line)) {
+int RTSPRequest::parseRequest(std::string_view req_str) {
+  bool is_requestLine = true;
+  while (!req_str.empty()) {
+    size_t eol = req_str.find('\n');
+    std::string_view line = req_str.substr(0, eol);
+    req_str.remove_prefix(eol == std::string_view::npos ? req_str.size()
+                                                        : eol + 1);
     if (!line.empty() && line.back() == '\r') {
-      line.pop_back();
+      line.remove_suffix(1);
     }
     if (line.empty()) {
       break;
@@ -41,97 +92,171 @@ int RTSPRequest::parseRequest(const std::string& req_str) {
       }
     }
   }
-  return 0;
+  return is_requestLine ? -1 : 0;
 }
-int RTSPRequest::parseRequestLine(const std::string& line) {
-  std::stringstream ss(line);
-  std::string method_str;
-  if (ss >> method_str >> url_ >> version_) {
-    method_ = Utils::Str2Method(method_str);
-    return 0;
+int RTSPRequest::parseRequestLine(std::string_view line) {
+  // METHOD SP URL SP VERSION
+  size_t first = line.find(' ');
+  size_t second = first == std::string_view::npos
+                      ? std::string_view::npos
+                      : line.find(' ', first + 1);
+  if (second == std::string_view::npos) {
+    return -1;
   }
-  return -1;
+  method_ = Utils::Str2Method(line.substr(0, first));
+  url_ = line.substr(first + 1, second - first - 1);
+  version_ = Utils::trim(line.substr(second + 1));
+  return url_.empty() || version_.empty() ? -1 : 0;
 }
-int RTSPRequest::parseOneLine(const std::string& line) {
-  auto pos = line.find(":");
-  if (pos == std::string::npos) {
+int RTSPRequest::parseOneLine(std::string_view line) {
+  auto pos = line.find(':');
+  if (pos == std::string_view::npos) {
     return -1;
   }
-  std::string key = Utils::trim(line.substr(0, pos));
-  std::string value = Utils::trim(line.substr(pos + 1));
-  if (key == "CSeq") {
-    seq_ = std::stoi(value);
-  } else if (key == "Session") {
-    session_id_ = value;
-  } else if (key == "Transport") {  // 解析协议及UDP端口号
-    size_t pos = value.find("client_port=");
-    if (pos != std::string::npos) {
-      // "client_port=" 长度为 12
-      const char* start_ptr = value.c_str() + pos + 12;
-
-      uint16_t rtp_port = 0;
-      uint16_t rtcp_port = 0;
-
-      if (sscanf(start_ptr, "%hu-%hu", &rtp_port, &rtcp_port) == 2) {
-        client_port_[0] = rtp_port;
-        client_port_[1] = rtcp_port;
+  std::string_view key = Utils::trim(line.substr(0, pos));
+  std::string_view value = Utils::trim(line.substr(pos + 1));
+  // 头部名称不区分大小写
+  if (Utils::iequals(key, "CSeq")) {
+    auto result =
+        std::from_chars(value.data(), value.data() + value.size(), seq_);
+    if (result.ec != std::errc()) {
+      return -1;
+    }
+  } else if (Utils::iequals(key, "Session")) {
+    // 可能带 ;timeout=60
+    session_id_ = value.substr(0, value.find(';'));
+  } else if (Utils::iequals(key, "Content-Length")) {
+    auto result = std::from_chars(value.data(), value.data() + value.size(),
+                                  content_length_);
+    if (result.ec != std::errc()) {
+      return -1;
+    }
+  } else if (Utils::iequals(key, "Transport")) {  // 解析协议及UDP端口号
+    // RTP/AVP/TCP;unicast;interleaved=0-1：RTP/RTCP 走 RTSP 的 TCP 连接
+    if (value.find("RTP/AVP/TCP") != std::string_view::npos) {
+      transport_ = TransportProtocol::TCP;
+      unsigned rtp_channel = 0;
+      unsigned rtcp_channel = 1;
+      if (parseNumberPair(findParameter(value, "interleaved="), rtp_channel,
+                          rtcp_channel) &&
+          rtp_channel < 256 && rtcp_channel < 256) {
+        interleaved_[0] = static_cast<uint8_t>(rtp_channel);
+        interleaved_[1] = static_cast<uint8_t>(rtcp_channel);
+      }
+    }
+    unsigned rtp_port = 0;
+    unsigned rtcp_port = 0;
+    if (parseNumberPair(findParameter(value, "client_port="), rtp_port,
+                        rtcp_port) &&
+        rtp_port <= 65535 && rtcp_port <= 65535) {
+      client_port_[0] = static_cast<uint16_t>(rtp_port);
+      client_port_[1] = static_cast<uint16_t>(rtcp_port);
+    }
+  } else if (Utils::iequals(key, "Range")) {
+    // 只支持 npt=起点-[终点]，now 视为从头开始
+    if (value.substr(0, 4) == "npt=") {
+      double start = 0;
+      auto result =
+          std::from_chars(value.data() + 4, value.data() + value.size(), start);
+      if (result.ec == std::errc() && start >= 0) {
+        range_start_ = start;
       }
     }
   }
   return 0;
 }
 
-void RTSPReply::generateSDP() {
-  std::stringstream ss;
-
-  // 基础头部
-  ss << "v=0\r\n";
-  ss << "o=- " << session_id_ << " 1 IN IP4 " << "127.0.0.1" << "\r\n";
-  ss << "s=Simple RTSP Server\r\n";
-  ss << "c=IN IP4 0.0.0.0\r\n";
-  ss << "t=0 0\r\n";
-
-  // 视频轨道  H.264
-  // 96 是动态负载类型，通常 H.264 用 96
-  ss << "m=video 0 RTP/AVP 96\r\n";
-  ss << "a=rtpmap:96 H264/90000\r\n";
+RTSPRequestParser::Result RTSPRequestParser::parse(std::string_view data,
+                                                   RTSPRequest& req) {
+  if (state_ == State::HEADER) {
+    // 从上次扫描到的位置继续找空行，回退 3 字节以防 \r\n\r\n 跨两次读取
+    size_t from = scan_pos_ >= 3 ? scan_pos_ - 3 : 0;
+    size_t end = data.find("\r\n\r\n", from);
+    if (end == std::string_view::npos) {
+      if (data.size() > kMaxHeaderSize) {
+        // 会话会丢掉缓冲区，下一条请求要从头扫描
+        reset();
+        return Result::ERROR;
+      }
+      scan_pos_ = data.size();
+      return Result::INCOMPLETE;
+    }
+    header_size_ = end + 4;
+    state_ = State::BODY;
+  }
+  // 头部每次都重新解析：缓冲区追加数据后可能搬家，上次解析出的视图已失效，
+  // 只有 body 没收全时才会走到第二次，很少见
+  req = RTSPRequest();
+  if (req.parseRequest(data.substr(0, header_size_)) != 0 ||
+      req.content_length_ > kMaxBodySize) {
+    reset();
+    return Result::ERROR;
+  }
+  size_t total = header_size_ + req.content_length_;
+  if (data.size() < total) {
+    return Result::INCOMPLETE;
+  }
+  req.body_ = data.substr(header_size_, req.content_length_);
+  consumed_ = total;
+  reset();
+  return Result::COMPLETE;
+}
 
-  ss << "a=fmtp:96 "
-        "packetization-mode=1\r\n";
+void RTSPRequestParser::reset() {
+  state_ = State::HEADER;
+  scan_pos_ = 0;
+  header_size_ = 0;
+}
 
-  ss << "a=control:track0\r\n";
-  sdp_ = ss.str();
+namespace {
+void appendNumber(std::string& out, int64_t value) {
+  char buf[24];
+  auto result = std::to_chars(buf, buf + sizeof(buf), value);
+  out.append(buf, result.ptr);
 }
+}  // namespace
 
-std::string RTSPReply::toString() const {
-  std::stringstream ss;
+void RTSPReply::serialize(std::string& out) const {
+  out.clear();
   // Status Line (例如: RTSP/1.0 200 OK)
-  ss << "RTSP/1.0 " << static_cast<int>(status_code_) << " "
-     << Utils::Code2Str(status_code_) << "\r\n";
+  out.append("RTSP/1.0 ");
+  appendNumber(out, static_cast<int>(status_code_));
+  out.push_back(' ');
+  out.append(Utils::Code2Str(status_code_));
+  out.append("\r\n");
   // Common Headers
-  ss << "CSeq: " << seq_ << "\r\n";
+  out.append("CSeq: ");
+  appendNumber(out, seq_);
+  out.append("\r\n");
   if (!session_id_.empty()) {
-    ss << "Session: " << session_id_ << "\r\n";
+    out.append("Session: ").append(session_id_).append("\r\n");
   }
   // Specific Headers
   if (status_code_ == StatusCode::OK) {
     switch (method_) {
       case RTSPMethod::OPTIONS:
-        ss << "Public: " << options_ << "\r\n";
+        out.append("Public: ").append(options_).append("\r\n");
         break;
 
       case RTSPMethod::DESCRIBE:
-        ss << "Content-Type: application/sdp\r\n";
-        ss << "Content-Length: " << sdp_.size() << "\r\n";
-        ss << "Content-Base: " << "rtsp://127.0.0.1:8554/live" << "\r\n";
+        out.append("Content-Type: application/sdp\r\n");
+        out.append("Content-Length: ");
+        appendNumber(out, sdp_ ? sdp_->size() : 0);
+        out.append("\r\n");
+        // 相对的 a=control 以它为基准，需要以 / 结尾
+        out.append("Content-Base: ").append(content_base_);
+        if (content_base_.empty() || content_base_.back() != '/') {
+          out.push_back('/');
+        }
+        out.append("\r\n");
         break;
 
       case RTSPMethod::SETUP:
-        ss << "Transport: " << transport_reply_ << "\r\n";
+        out.append("Transport: ").append(transport_reply_).append("\r\n");
         break;
       case RTSPMethod::PLAY:
         if (!range_.empty()) {
-          ss << "Range: " << range_ << "\r\n";
+          out.append("Range: ").append(range_).append("\r\n");
         }
         break;
 
@@ -139,26 +264,33 @@ std::string RTSPReply::toString() const {
         break;
     }
   }
-  ss << "\r\n";
-  if (method_ == RTSPMethod::DESCRIBE && !sdp_.empty()) {
-    ss << sdp_;
+  out.append("\r\n");
+  if (method_ == RTSPMethod::DESCRIBE && status_code_ == StatusCode::OK &&
+      sdp_) {
+    out.append(*sdp_);
   }
-
-  return ss.str();
 }
 
-RTSPSession::RTSPSession(net::io_context& ioc)
-    : session_id_(Utils::GenerateUUID()),
-      client_socket_(ioc),
-      RTP_socket_(ioc),
-      RTCP_socket_(ioc),
-      timer_(ioc) {
+RTSPSession::RTSPSession(tcp::socket socket)
+    : ioc_(static_cast<net::io_context&>(socket.get_executor().context())),
+      load_(AsioIOServicePool::GetInstance()->GetLoad(ioc_)),
+      session_id_(Utils::GenerateUUID()),
+      client_socket_(std::move(socket)),
+      tcp_sender_(client_socket_,
+                  ServerConfig::GetInstance()->tcp_max_queue_bytes),
+      timer_(ioc_) {
   read_buffer_.resize(4096);
+  if (load_ != nullptr) {
+    load_->sessions++;
+  }
 }
 
 RTSPSession::~RTSPSession() {
   clearFile();
   closeSocket();
+  if (load_ != nullptr) {
+    load_->sessions--;
+  }
   std::cout << "session析构" << std::endl;
 }
 
@@ -166,6 +298,7 @@ tcp::socket& RTSPSession::Socket() { return client_socket_; }
 
 void RTSPSession::pickRequest() {
   auto self = shared_from_this();
+  tcp_sender_.setOwner(self);
   client_socket_.async_read_some(
       boost::asio::buffer(read_buffer_),
       [this, self](boost::system::error_code ec,
@@ -183,37 +316,64 @@ void RTSPSession::pickRequest() {
 }
 
 void RTSPSession::analysRequestAndMakeReply() {
-  while (true) {
-    auto end_pos = in_buffer_.find("\r\n\r\n");
-    if (end_pos == std::string::npos) {
-      return;
+  // [in_offset_, size) 为未处理的数据，处理完一批后统一搬移，不再每条消息 erase 一次
+  // 等待线程池打开文件时暂停，打开之后再继续处理
+  while (!open_pending_ && in_offset_ < in_buffer_.size()) {
+    std::string_view data(in_buffer_.data() + in_offset_,
+                          in_buffer_.size() - in_offset_);
+    // TCP 交错传输时客户端发来的 RTCP：$ + 通道号 + 2 字节长度 + 数据
+    if (data[0] == '$' && parser_.idle()) {
+      if (data.size() < 4) {
+        break;
+      }
+      size_t len = (static_cast<uint8_t>(data[2]) << 8) |
+                   static_cast<uint8_t>(data[3]);
+      if (data.size() < 4 + len) {
+        break;
+      }
+      uint8_t channel = static_cast<uint8_t>(data[1]);
+      for (size_t i = 0; i < kMaxTracks; ++i) {
+        if (tracks_[i] && tracks_[i]->transport == TransportProtocol::TCP &&
+            tracks_[i]->interleaved[1] == channel) {
+          handleRtcp(i, reinterpret_cast<const uint8_t*>(data.data()) + 4,
+                     len);
+        }
+      }
+      in_offset_ += 4 + len;
+      continue;
     }
-    size_t msg_len = end_pos + 4;
-    std::string req_str = in_buffer_.substr(0, msg_len);
-    in_buffer_.erase(0, msg_len);
     RTSPRequest req;
-    std::cout << "请求： " << req_str;
-    if (req.parseRequest(req_str) != 0) {
+    auto result = parser_.parse(data, req);
+    if (result == RTSPRequestParser::Result::INCOMPLETE) {
+      break;
+    }
+    if (result == RTSPRequestParser::Result::ERROR) {
       std::cerr << "Parse Error" << std::endl;
-      // 发送 400 Bad Request
+      // 发送 400 Bad Request，剩下的数据无法再对齐，全部丢弃
       handleBadRequest(req);
+      in_buffer_.clear();
+      in_offset_ = 0;
       return;
     }
+    size_t request_offset = in_offset_;
+    in_offset_ += parser_.consumed();
+    std::cout << "请求： " << data.substr(0, parser_.consumed());
     RTSPReply reply;
     reply.seq_ = req.seq_;
     reply.method_ = req.method_;
+    bool done = true;
     switch (req.method_) {
       case RTSPMethod::OPTIONS:
         handleOptions(req, reply);
         break;
       case RTSPMethod::DESCRIBE:
-        handleDescribe(req, reply);
+        done = handleDescribe(req, reply);
         break;
       case RTSPMethod::SETUP:
-        handleSetup(req, reply);
+        done = handleSetup(req, reply);
         break;
       case RTSPMethod::PLAY:
-        handlePlay(req, reply);
+        done = handlePlay(req, reply);
         break;
       case RTSPMethod::TEARDOWN:
         handleTeardown(req, reply);
@@ -222,9 +382,20 @@ void RTSPSession::analysRequestAndMakeReply() {
         reply.status_code_ = StatusCode::METHOD_NOT_ALLOWED;
         break;
     }
-    std::cout << "回复： " << reply.toString();
+    if (!done) {
+      // 文件打开后由 finishOpen 从这条请求重新处理
+      in_offset_ = request_offset;
+      break;
+    }
     sendReply(reply);
   }
+  if (in_offset_ == in_buffer_.size()) {
+    in_buffer_.clear();
+    in_offset_ = 0;
+  } else if (in_offset_ > 0) {
+    in_buffer_.erase(0, in_offset_);
+    in_offset_ = 0;
+  }
 }
 
 void RTSPSession::handleOptions(const RTSPRequest& req, RTSPReply& reply) {
@@ -232,224 +403,630 @@ void RTSPSession::handleOptions(const RTSPRequest& req, RTSPReply& reply) {
   reply.options_ = "OPTIONS, DESCRIBE, SETUP, PLAY, TEARDOWN";
 }
 
-void RTSPSession::handleDescribe(const RTSPRequest& req, RTSPReply& reply) {
+bool RTSPSession::findSource(const std::string& path,
+                             std::shared_ptr<const MediaSource>& source) {
+  if (opened_path_ == path) {
+    opened_path_.clear();
+    source = std::move(opened_source_);
+    return true;
+  }
+  source = MediaCatalog::GetInstance()->cached(path);
+  if (source) {
+    return true;
+  }
+  // 第一次打开要映射、建索引，放到线程池中，不阻塞这个线程上的其它会话
+  open_pending_ = true;
+  auto self = shared_from_this();
+  auto executor = client_socket_.get_executor();
+  ThreadPool::GetInstance()->post([self, executor, path]() {
+    auto source = MediaCatalog::GetInstance()->open(path);
+    net::post(executor,
+              [self, path, source]() { self->finishOpen(path, source); });
+  });
+  return false;
+}
+
+void RTSPSession::finishOpen(const std::string& path,
+                             std::shared_ptr<const MediaSource> source) {
+  open_pending_ = false;
+  opened_path_ = path;
+  opened_source_ = std::move(source);
+  // 重新处理等待的请求和之后收到的请求
+  analysRequestAndMakeReply();
+}
+
+bool RTSPSession::handleDescribe(const RTSPRequest& req, RTSPReply& reply) {
+  auto catalog = MediaCatalog::GetInstance();
+  const std::string* path = catalog->resolve(req.url_);
+  if (!path) {
+    reply.status_code_ = StatusCode::NOT_FOUND;
+    return true;
+  }
+  std::shared_ptr<const MediaSource> source;
+  if (!findSource(*path, source)) {
+    return false;
+  }
+  if (!source) {
+    reply.status_code_ = StatusCode::NOT_FOUND;
+    return true;
+  }
   reply.status_code_ = StatusCode::OK;
-  reply.generateSDP();  // 生成 SDP 信息的函数
+  reply.sdp_ = SDPCache::GetInstance()->get(source);
+  reply.content_base_ = req.url_;
+  return true;
 }
 
-void RTSPSession::handleSetup(const RTSPRequest& req, RTSPReply& reply) {
+bool RTSPSession::handleSetup(const RTSPRequest& req, RTSPReply& reply) {
+  // SETUP 的 URL 决定这个会话播放哪个文件，以及是哪一路
+  auto catalog = MediaCatalog::GetInstance();
+  const std::string* path = catalog->resolve(req.url_);
+  size_t index = trackFromUrl(req.url_);
+  auto config = ServerConfig::GetInstance();
+  if (path && index == kAudioTrack) {
+    // 只有带音频的文件才有 track1，直播模式不转发音频
+    std::shared_ptr<const MediaSource> source;
+    if (!config->broadcast && !findSource(*path, source)) {
+      return false;
+    }
+    if (!source || !source->audio()) {
+      path = nullptr;
+    }
+  }
+  if (!path || index >= kMaxTracks) {
+    reply.status_code_ = StatusCode::NOT_FOUND;
+    return true;
+  }
+  media_path_ = *path;
   reply.status_code_ = StatusCode::OK;
   reply.session_id_ = session_id_;
+  // 监听中尚未接入的会话不计入指标，SETUP 时才登记
+  if (!stats_) {
+    stats_ = Metrics::GetInstance()->createSessionStats(session_id_);
+  }
+  if (!tracks_[index]) {
+    tracks_[index] = std::make_unique<RTSPTrack>(ioc_);
+  }
+  RTSPTrack& track = *tracks_[index];
 
+  if (req.transport_ == TransportProtocol::TCP) {
+    track.transport = TransportProtocol::TCP;
+    track.interleaved[0] = req.interleaved_[0];
+    track.interleaved[1] = req.interleaved_[1];
+    reply.transport_reply_ =
+        "RTP/AVP/TCP;unicast;interleaved=" +
+        std::to_string(track.interleaved[0]) + "-" +
+        std::to_string(track.interleaved[1]);
+    return true;
+  }
+  track.transport = TransportProtocol::UDP;
+  if (track.server_rtp_port == 0 && !openUdpPorts(index)) {
+    reply.status_code_ = StatusCode::UNSUPPORTED_TRANSPORT;
+    return true;
+  }
+  auto client_ip = client_socket_.remote_endpoint().address();
+  track.rtp_client_endpoint = udp::endpoint(client_ip, req.client_port_[0]);
+  track.rtcp_client_endpoint = udp::endpoint(client_ip, req.client_port_[1]);
   reply.transport_reply_ =
       "RTP/AVP;unicast;client_port=" + std::to_string(req.client_port_[0]) +
-      "-" + std::to_string(req.client_port_[1]) + ";server_port=55000-55001";
+      "-" + std::to_string(req.client_port_[1]) +
+      ";server_port=" + std::to_string(track.server_rtp_port) + "-" +
+      std::to_string(track.server_rtp_port + 1);
+  // NACK 重传用的历史包，SETUP 时一次分配好，TCP 不丢包所以不需要
+  if (config->nack_history_packets > 0 && !track.retransmit) {
+    track.retransmit =
+        std::make_unique<RetransmitBuffer>(config->nack_history_packets);
+    // 一个 NACK 最多请求 17 个包，通常一个 RTCP 包只带几个 FCI
+    retransmit_packets_.reserve(17 * 8);
+  }
+  // 平滑发送：同一 io_context 上的会话共用一个时间轮；音频的包又小又少，不需要
+  if (index == kVideoTrack && config->pacing_peak_rate_mbps > 0 &&
+      !track.packet_pacer) {
+    track.packet_pacer = std::make_unique<PacketPacer>(
+        net::use_service<TimerWheel>(ioc_), track.rtp_sender,
+        track.rtp_client_endpoint,
+        static_cast<uint64_t>(config->pacing_peak_rate_mbps * 1000000),
+        config->pacing_burst_bytes);
+  }
+  return true;
+}
 
-  // 初始化 RTP和RTCP 发送的 Socket
-  if (!RTP_socket_.is_open()) {
-    RTP_socket_.open(udp::v4());
-    RTP_socket_.bind(udp::endpoint(udp::v4(), 55000));
-    auto client_ip = client_socket_.remote_endpoint().address();
-    RTP_client_endpoint_ = udp::endpoint(client_ip, req.client_port_[0]);
+bool RTSPSession::openUdpPorts(size_t index) {
+  // 初始化 RTP和RTCP 发送的 Socket，端口对从分配器获取，可能被其他进程占用，多试几次
+  RTSPTrack& track = *tracks_[index];
+  auto allocator = PortAllocator::GetInstance();
+  for (int attempt = 0; attempt < 8 && track.server_rtp_port == 0;
+       ++attempt) {
+    uint16_t port = allocator->allocate();
+    if (port == 0) {
+      break;
+    }
+    boost::system::error_code ec;
+    track.rtp_socket.open(udp::v4(), ec);
+    track.rtcp_socket.open(udp::v4(), ec);
+    track.rtp_socket.bind(udp::endpoint(udp::v4(), port), ec);
+    if (!ec) {
+      track.rtcp_socket.bind(udp::endpoint(udp::v4(), port + 1), ec);
+    }
+    if (ec) {
+      boost::system::error_code ignored;
+      track.rtp_socket.close(ignored);
+      track.rtcp_socket.close(ignored);
+      // 放到栈底，下一次尝试换一对端口
+      allocator->releaseBusy(port);
+      continue;
+    }
+    track.server_rtp_port = port;
   }
-  if (!RTCP_socket_.is_open()) {
-    RTCP_socket_.open(udp::v4());
-    RTCP_socket_.bind(udp::endpoint(udp::v4(), 55001));
-    auto client_ip = client_socket_.remote_endpoint().address();
-    RTCP_client_endpoint_ = udp::endpoint(client_ip, req.client_port_[1]);
+  if (track.server_rtp_port == 0) {
+    return false;
   }
+  startRtcpReceive(index);
+  return true;
 }
 
-void RTSPSession::handlePlay(const RTSPRequest& req, RTSPReply& reply) {
+bool RTSPSession::handlePlay(const RTSPRequest& req, RTSPReply& reply) {
   reply.status_code_ = StatusCode::OK;
   reply.session_id_ = session_id_;
-  reply.range_ = "npt=0.000-9.000";
-  if (!video_file_.is_open()) {
-    video_file_.open(
-        "/home/ranx/work/edoyun/videoRTSPServer/data/"
-        "TheaterSquare_3840x2160.h264",
-        std::ios::binary);
+  if (media_path_.empty()) {
+    reply.status_code_ = StatusCode::SESSION_NOT_FOUND;
+    return true;
+  }
+  auto config = ServerConfig::GetInstance();
+  if (config->broadcast && !tracks_[kVideoTrack]) {
+    reply.status_code_ = StatusCode::SESSION_NOT_FOUND;
+    return true;
+  }
+  // 同一文件只映射、索引一次，会话只持有游标；通常 DESCRIBE 时已经打开
+  // 直播模式已经加入 hub 时不需要再取
+  std::shared_ptr<const MediaSource> source;
+  if (!(config->broadcast && hub_) && !findSource(media_path_, source)) {
+    return false;
+  }
+  if (config->broadcast) {
+    // 直播模式：加入该路流的 hub，从下一个关键帧开始接收
+    if (!hub_) {
+      if (!source) {
+        reply.status_code_ = StatusCode::NOT_FOUND;
+        return true;
+      }
+      hub_ = BroadcastHub::get(source);
+      waiting_key_ = true;
+      hub_->subscribe(shared_from_this(), client_socket_.get_executor());
+    }
+    reply.range_ = "npt=now-";
+    return true;
+  }
+  if (!source) {
+    reply.status_code_ = StatusCode::NOT_FOUND;
+    return true;
+  }
+  // 按文件的编码创建打包器；再次 PLAY 时沿用，序号保持连续
+  // 已经在播放的路不带 Range 时继续原来的预读，带 Range 时从新位置重新开始
+  bool seek = req.range_start_ >= 0;
+  MediaCursor video_cursor;
+  AudioCursor audio_cursor;
+  if (tracks_[kVideoTrack] && (!prefetchers_[kVideoTrack] || seek)) {
+    RTSPTrack& video = *tracks_[kVideoTrack];
+    video_cursor = MediaCursor(source);
+    if (!video.packetizer) {
+      video.packetizer = makePacketizer(source->codec(), kVideoPayloadType, kSSRC);
+      video.pacer = makeVideoPacer(*source, fps_);
+    }
   }
+  if (tracks_[kAudioTrack] && source->audio() &&
+      (!prefetchers_[kAudioTrack] || seek)) {
+    RTSPTrack& audio = *tracks_[kAudioTrack];
+    const auto& audio_source = source->audio();
+    audio_cursor = AudioCursor(audio_source);
+    if (!audio.packetizer) {
+      // G.711 用静态负载类型，AAC 用动态的 97，与 SDP 一致
+      audio.packetizer =
+          makePacketizer(audio_source->codec(),
+                         static_cast<uint8_t>(audio_source->codec()),
+                         kSSRC + 1);
+      audio.clock_rate = audio_source->clockRate();
+      audio.pacer = FramePacer(audio_source->clockRate(),
+                               audio_source->samplesPerFrame());
+    }
+  }
+  // 带 Range 时视频跳到最近的 IDR 帧，音频对齐到同一时刻
+  // MP4 按帧的时间戳换算，裸码流按固定帧率
+  size_t start_unit = 0;
+  if (seek) {
+    start_unit = video_cursor.seekToKeyUnit(
+        source->unitAtTime(req.range_start_, fps_));
+    audio_cursor.seekToTime(video_cursor.isOpen()
+                                ? source->unitTime(start_unit, fps_)
+                                : req.range_start_);
+  }
+  source_ = source;
+  if (video_cursor.isOpen()) {
+    startPrefetch(kVideoTrack, [cursor = std::move(video_cursor)](
+                                   PrefetchedFrame& frame) mutable {
+      if (!cursor.readNextAccessUnit(frame.nalus)) {
+        return false;
+      }
+      frame.index = cursor.position() - 1;
+      frame.is_key = cursor.source()->accessUnit(frame.index).is_key;
+      return true;
+    });
+  }
+  if (audio_cursor.isOpen()) {
+    startPrefetch(kAudioTrack, [cursor = std::move(audio_cursor)](
+                                   PrefetchedFrame& frame) mutable {
+      return cursor.readNextFrame(frame.nalus);
+    });
+  }
+  char range[64];
+  snprintf(range, sizeof(range), "npt=%.3f-%.3f",
+           source->unitTime(start_unit, fps_),
+           source->unitTime(source->accessUnitCount(), fps_));
+  reply.range_ = range;
   // 开始推流逻辑
   startRtpSending();
+  return true;
 }
 
 void RTSPSession::handleTeardown(const RTSPRequest& req, RTSPReply& reply) {
   reply.status_code_ = StatusCode::OK;
   reply.session_id_ = session_id_;
   clearFile();
-  
+  // UDP 端口立即归还，RTSP 连接等回复发完再关闭
+  for (auto& track : tracks_) {
+    if (track) {
+      track->packet_pacer.reset();
+    }
+  }
+  closeRtpSocket();
 }
 
-void RTSPSession::handleBadRequest(const RTSPRequest& req) {}
+void RTSPSession::handleBadRequest(const RTSPRequest& req) {
+  RTSPReply reply;
+  reply.status_code_ = StatusCode::BAD_REQUEST;
+  reply.method_ = req.method_;
+  reply.seq_ = req.seq_;
+  sendReply(reply);
+}
 
 void RTSPSession::sendReply(const RTSPReply& reply) {
-  std::string response_str = reply.toString();
-
-  auto self = shared_from_this();
-
-  boost::asio::async_write(client_socket_, boost::asio::buffer(response_str),
-                           [this, self, reply](boost::system::error_code ec,
-                                        std::size_t bytes_transferred) {
-                             if (ec) {
-                               // 处理发送错误，比如打印日志或断开连接
-                               // handleError(ec);
-                             } else {
-                               // 发送成功
-                               // 如果是 TEARDOWN 的响应，发送完可能需要主动关闭
-                               if(reply.method_ == RTSPMethod::TEARDOWN) {
-                                closeSocket();
-                               }
-                             }
-                           });
+  // 与 TCP 交错传输的 RTP 数据共用一个写队列，TEARDOWN 的回复发完后关闭连接
+  reply.serialize(reply_buffer_);
+  std::cout << "回复： " << reply_buffer_;
+  tcp_sender_.sendText(reply_buffer_,
+                       reply.method_ == RTSPMethod::TEARDOWN);
 }
 
 void RTSPSession::clearFile() {
-  video_file_.clear();
-  video_file_.seekg(0);
-  if (video_file_.is_open()) {
-    video_file_.close();
+  // 历史包的负载指向即将释放的文件映射
+  for (auto& track : tracks_) {
+    if (track && track->retransmit) {
+      track->retransmit->clear();
+    }
+  }
+  stopPrefetch();
+  source_.reset();
+  if (hub_) {
+    hub_->unsubscribe(this);
+    hub_.reset();
   }
   timer_.cancel();
 }
 
 void RTSPSession::closeSocket() {
-  if (RTP_socket_.is_open()) {
-    std::cout << "关闭RTP socket " << std::endl;
-    RTP_socket_.close();
-  }
-  if (RTCP_socket_.is_open()) {
-    std::cout << "关闭RTCP socket " << std::endl;
-    RTCP_socket_.close();
-  }
+  closeRtpSocket();
   if(client_socket_.is_open()) {
     std::cout << "关闭客户端 socket " << std::endl;
     client_socket_.close();
   }
 }
 
+void RTSPSession::closeRtpSocket() {
+  for (auto& track : tracks_) {
+    if (!track) {
+      continue;
+    }
+    if (track->rtp_socket.is_open()) {
+      // 排队中的异步发送先交给内核，之后关闭不影响它们
+      track->rtp_sender.flush();
+      std::cout << "关闭RTP socket " << std::endl;
+      track->rtp_socket.close();
+    }
+    if (track->rtcp_socket.is_open()) {
+      std::cout << "关闭RTCP socket " << std::endl;
+      track->rtcp_socket.close();
+    }
+    // 归还端口对，供后面的会话使用
+    if (track->server_rtp_port != 0) {
+      PortAllocator::GetInstance()->release(track->server_rtp_port);
+      track->server_rtp_port = 0;
+    }
+  }
+}
+
 void RTSPSession::startRtpSending() {
-  auto self = shared_from_this();
+  // 各路以同一时刻为起点，第 n 帧在起点 + n × 帧长时发送，音视频由此对齐
+  auto now = FramePacer::Clock::now();
+  for (auto& track : tracks_) {
+    if (track) {
+      track->pacer.reset(now);
+    }
+  }
+  scheduleNextFrame();
+}
 
-  // 设置定时器：每 (1000/fps) 触发一次
-  timer_.expires_after(std::chrono::milliseconds(1000 / fps_));
-  timer_.async_wait([this, self](boost::system::error_code ec) {
-    if (!ec) {
-      sendOneH264Frame();
-      startRtpSending();
+void RTSPSession::startPrefetch(size_t index, FramePrefetcher::ReadFn read) {
+  if (prefetchers_[index]) {
+    prefetchers_[index]->stop();
+  }
+  auto prefetcher = std::make_shared<FramePrefetcher>(
+      std::move(read), tracks_[index]->pacer.frameDuration());
+  // 预读回调不持有会话，会话先析构时直接丢弃
+  std::weak_ptr<RTSPSession> weak = shared_from_this();
+  prefetcher->start(client_socket_.get_executor(), [weak]() {
+    if (auto self = weak.lock()) {
+      self->scheduleNextFrame();
+    }
+  });
+  prefetchers_[index] = std::move(prefetcher);
+}
+
+void RTSPSession::stopPrefetch() {
+  for (auto& prefetcher : prefetchers_) {
+    if (prefetcher) {
+      prefetcher->stop();
+      prefetcher.reset();
+    }
+  }
+}
+
+size_t RTSPSession::nextTrack() const {
+  size_t next = kMaxTracks;
+  if (prefetchers_[kVideoTrack]) {
+    next = kVideoTrack;
+  }
+  if (prefetchers_[kAudioTrack] &&
+      (next == kMaxTracks || tracks_[kAudioTrack]->pacer.deadline() <
+                                 tracks_[kVideoTrack]->pacer.deadline())) {
+    next = kAudioTrack;
+  }
+  return next;
+}
+
+void RTSPSession::scheduleNextFrame() {
+  size_t index = nextTrack();
+  if (index == kMaxTracks) {
+    return;
+  }
+  auto self = shared_from_this();
+  // 按绝对时刻定时，处理耗时不会累积成漂移
+  timer_.expires_at(tracks_[index]->pacer.deadline());
+  timer_.async_wait([this, self, index](boost::system::error_code ec) {
+    if (!ec && sendOneFrame(index)) {
+      scheduleNextFrame();
     }
   });
 }
 
+// 每次发送一整帧（视频的访问单元或音频的一个 AU），起始码不参与发送
+// 帧已由线程池预读好，这里不会因为读盘阻塞同一线程上的其它会话
+bool RTSPSession::sendOneFrame(size_t index) {
+  RTSPTrack& track = *tracks_[index];
+  FramePrefetcher& prefetcher = *prefetchers_[index];
+  bool is_video = index == kVideoTrack;
+  PrefetchedFrame* frame = prefetcher.front();
+  if (frame == nullptr) {
+    if (!prefetcher.finished()) {
+      // 预读没跟上：不在这里读盘，等帧读好后由回调重新调度
+      ++stats_->prefetch_underruns;
+      return !prefetcher.waitReady();
+    }
+    // 这一路播完了，另一路继续；都播完时释放文件
+    prefetchers_[index].reset();
+    if (nextTrack() == kMaxTracks) {
+      clearFile();
+    }
+    return true;
+  }
+
+  // 时间戳由帧位置按各自的时钟推算（视频 90000Hz，音频为采样率），同一帧的所有包时间戳相同
+  if (is_video) {
+    track.rtp_timestamp =
+        advanceVideoPacer(track.pacer, *source_, frame->index);
+  } else {
+    track.rtp_timestamp = track.pacer.rtpTimestamp(track.clock_rate);
+    track.pacer.advance();
+  }
+  // 落后超过一秒就重新计时，不再突发补发积压的帧；各路一起重新计时，保持对齐
+  auto now = FramePacer::Clock::now();
+  if (now - track.pacer.deadline() > std::chrono::seconds(1)) {
+    for (auto& t : tracks_) {
+      if (t) {
+        t->pacer.reset(now);
+      }
+    }
+  }
+
+  packets_.clear();
+  track.packetizer->packetize(frame->nalus, track.rtp_timestamp, packets_);
+  if (is_video) {
+    sendPackets(track, packets_, source_, frame->is_key);
+  } else {
+    // TCP 积压时音频跟着视频一起等关键帧；没有视频时每帧都可以恢复
+    sendPackets(track, packets_, source_->audio(),
+                !prefetchers_[kVideoTrack]);
+  }
+  // 包里只引用文件内存，槽位可以交还给预读
+  prefetcher.pop();
+  return true;
+}
+
+void RTSPSession::sendPackets(RTSPTrack& track,
+                              const std::vector<RTPPacket>& packets,
+                              std::shared_ptr<const void> owner, bool is_key) {
+  if (packets.empty()) {
+    return;
+  }
+  // SR 里的包数和负载字节数
+  size_t octets = 0;
+  for (const RTPPacket& packet : packets) {
+    octets += packet.size() - RTPPacket::kRTPHeaderSize;
+  }
+  track.packet_count += packets.size();
+  track.octet_count += octets;
+  stats_->rtp_packets += packets.size();
+  stats_->rtp_octets += octets;
+  if (load_ != nullptr) {
+    load_->octets.fetch_add(octets, std::memory_order_relaxed);
+  }
+  // 直播共用 SSRC 时以 hub 的 SSRC 为准
+  track.ssrc = packets.back().ssrc();
+  maybeSendSenderReport(track, packets.back().timestamp());
 
-// 读取一个NALU并切片发送  起始码不参与发送
-void RTSPSession::sendOneH264Frame() {
-  if (!video_file_.is_open() || video_file_.eof()) {
-    clearFile();
+  if (track.transport == TransportProtocol::TCP) {
+    // 整帧一次写入 RTSP 连接
+    tcp_sender_.sendFrame(packets, track.interleaved[0], is_key,
+                          std::move(owner));
     return;
   }
-  Nalu nalu = Nalu::readNextNalu(video_file_);
-  if (!nalu.is_valid || nalu.data.empty()) {
+  if (track.retransmit) {
+    track.retransmit->store(packets.data(), packets.size());
+  }
+  if (track.packet_pacer) {
+    // 分散到一个帧间隔内发出
+    track.packet_pacer->enqueue(packets, track.pacer.frameDuration(),
+                                std::move(owner));
     return;
   }
+  // 一次系统调用发送整帧，负载直接引用映射的文件内存；
+  // 走 io_uring 时异步提交，由 owner 保证发送完成前负载有效
+  track.rtp_sender.send(packets, track.rtp_client_endpoint, std::move(owner));
+}
 
-  // H.264 的时间戳单位是 90000Hz。每帧增加 90000/FPS
-  rtp_timestamp_ += (90000 / fps_);
+void RTSPSession::onBroadcast(const std::shared_ptr<const RTPBatch>& batch) {
+  RTSPTrack* track = tracks_[kVideoTrack].get();
+  if (!hub_ || !track || batch->packets.empty() ||
+      (track->transport == TransportProtocol::UDP &&
+       !track->rtp_socket.is_open())) {
+    return;
+  }
+  if (waiting_key_) {
+    if (!batch->is_key) {
+      return;
+    }
+    waiting_key_ = false;
+    // 时间戳从本会话自己的起点开始
+    broadcast_ts_offset_ = track->rtp_timestamp - batch->packets[0].timestamp();
+  }
+  if (ServerConfig::GetInstance()->broadcast_shared_ssrc) {
+    sendPackets(*track, batch->packets, batch, batch->is_key);
+    return;
+  }
+  // 负载共享，只拷贝并改写包头
+  packets_.assign(batch->packets.begin(), batch->packets.end());
+  for (RTPPacket& packet : packets_) {
+    packet.setSeq(broadcast_seq_++);
+    packet.setTimestamp(packet.timestamp() + broadcast_ts_offset_);
+    packet.setSsrc(kSSRC);
+  }
+  sendPackets(*track, packets_, batch, batch->is_key);
+}
 
-  // 限制包大小, MTU通常为1500
-  const size_t MAX_RTP_PAYLOAD_SIZE = 1400;
+void RTSPSession::maybeSendSenderReport(RTSPTrack& track,
+                                        uint32_t rtp_timestamp) {
+  // RFC 3550 建议的最小间隔 5 秒，第一帧发出后立即发一次，方便接收端尽早同步
+  // 各路的 SR 用同一个 CNAME，接收端据此把 NTP 时间对齐，实现唇音同步
+  auto now = std::chrono::steady_clock::now();
+  if (now < track.next_sr_time) {
+    return;
+  }
+  track.next_sr_time = now + std::chrono::seconds(5);
 
-  // 判断是否需要分片
-  if (nalu.data.size() <= MAX_RTP_PAYLOAD_SIZE) {
-    //*   0 1 2 3 4 5 6 7 8 9
-    //*  +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
-    //*  |F|NRI|  Type   | a single NAL unit ... |
-    //*  +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
-    // F : 禁止位，0。
-    // NRI: 重要性指示。比如 IDR 帧是 11 (3)，普通 P 帧是 10 (2)。
-    // Type: 原始类型。比如 5 代表 IDR，7 代表 SPS
-    RTPPacket packet(96, rtp_seq_++, rtp_timestamp_, rtp_ssrc_, true);
-    packet.setPayload(nalu.data.data(), nalu.data.size());
+  RTCPSenderInfo info;
+  info.ssrc = track.ssrc;
+  info.ntp_time = ntpNow();
+  info.rtp_timestamp = rtp_timestamp;
+  info.packet_count = track.packet_count;
+  info.octet_count = track.octet_count;
+  uint8_t report[128];
+  size_t size =
+      buildSenderReport(info, "rtsp-" + session_id_, report, sizeof(report));
+  if (size == 0) {
+    return;
+  }
+  ++stats_->rtcp_sr_sent;
+  if (track.transport == TransportProtocol::TCP) {
+    tcp_sender_.sendInterleaved(track.interleaved[1], report, size);
+  } else if (track.rtcp_socket.is_open()) {
+    boost::system::error_code ec;
+    track.rtcp_socket.send_to(boost::asio::buffer(report, size),
+                              track.rtcp_client_endpoint, 0, ec);
+  }
+}
 
-    auto pbuffer = std::make_shared<std::vector<uint8_t>>(packet.getBuffer());
-    RTP_socket_.async_send_to(boost::asio::buffer(*pbuffer),
-                              RTP_client_endpoint_, [pbuffer](auto, auto) {});
-  } else {
-    // 拆分原来的NALU头，将信息重组为FU indicator和FU Header
-    //*  0                   1                   2
-    //*  0 1 2 3 4 5 6 7 8 9 0 1 2 3 4 5 6 7 8 9 0 1 2 3
-    //* +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
-    //* | FU indicator  |   FU header   |   FU payload   ...  |
-    //* +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
-
-    //*     FU Indicator
-    //*    0 1 2 3 4 5 6 7
-    //*   +-+-+-+-+-+-+-+-+
-    //*   |F|NRI|  Type   |
-    //*   +---------------+
-    // F和NRI和原始NALU头一致
-    // type改为28，28 在 H.264 标准里是 FU-A 分片单元
-
-    //*      FU Header
-    //*    0 1 2 3 4 5 6 7
-    //*   +-+-+-+-+-+-+-+-+
-    //*   |S|E|R|  Type   |
-    //*   +---------------+
-    // S (Start bit): 开始位。如果是分片的第一个包，置 1；否则置 0。
-    // E (End bit): 结束位。如果是分片的最后一个包，置 1；否则置 0。
-    // R (Reserved): 保留位，必须是 0。
-    // type与NALU头一致
-
-    uint8_t nalu_header = nalu.data[0];
-    uint8_t nri = nalu_header & 0x60;   // 与上0110 0000以保留NRI
-    uint8_t type = nalu_header & 0x1F;  // 与上0001 1111以保留NALU Type
-
-    // 去掉 NALU 头，只切分数据部分
-    const uint8_t* nalu_payload = nalu.data.data() + 1;
-    size_t nalu_payload_size = nalu.data.size() - 1;
-    size_t offset = 0;
-
-    while (offset < nalu_payload_size) {
-      // 计算当前分片大小
-      size_t chunk_size =
-          std::min(MAX_RTP_PAYLOAD_SIZE, nalu_payload_size - offset);
-
-      // 是不是最后一个分片？(如果是，Marker=true)
-      bool is_last_chunk = (offset + chunk_size >= nalu_payload_size);
-
-      // 构建 FU Indicator (1字节)
-      // 或上0001 1100，相当于直接把28加在低位
-      // 高三位还是F和NRI
-      uint8_t fu_indicator = nri | 28;
-
-      // 构建 FU Header (1字节)
-      // S(Start), E(End), R(0), Type(原NALU Type)
-      uint8_t fu_header = type;
-      bool is_start_chunk = (offset == 0);
-      // 1000 0000
-      if (is_start_chunk) fu_header |= 0x80;  // Set S bit
-      // 0100 0000
-      else if (is_last_chunk)
-        fu_header |= 0x40;  // Set E bit
-
-      // 组装 Payload: FU Indicator + FU Header + Chunk Data
-      std::vector<uint8_t> fragment;
-      fragment.push_back(fu_indicator);
-      fragment.push_back(fu_header);
-      fragment.insert(fragment.end(), nalu_payload + offset,
-                      nalu_payload + offset + chunk_size);
-
-      // 发送 RTP 包
-      // Marker 位：只有整个帧的最后一个包才置为 true
-      RTPPacket packet(96, rtp_seq_++, rtp_timestamp_, rtp_ssrc_,
-                       is_last_chunk);
-      packet.setPayload(fragment.data(), fragment.size());
-
-      // 分片采用同步发送，懒得思考异步逻辑了
-      auto buffer = packet.getBuffer();
-      RTP_socket_.send_to(boost::asio::buffer(buffer), RTP_client_endpoint_);
-
-      offset += chunk_size;
-    }
-  }
-}
\ No newline at end of file
+void RTSPSession::startRtcpReceive(size_t index) {
+  auto self = shared_from_this();
+  RTSPTrack& track = *tracks_[index];
+  track.rtcp_socket.async_receive_from(
+      boost::asio::buffer(track.rtcp_recv_buffer), track.rtcp_remote_endpoint,
+      [this, self, index](boost::system::error_code ec, std::size_t size) {
+        if (ec) {
+          // socket 关闭时退出
+          return;
+        }
+        handleRtcp(index, tracks_[index]->rtcp_recv_buffer.data(), size);
+        startRtcpReceive(index);
+      });
+}
+
+void RTSPSession::handleRtcp(size_t index, const uint8_t* data, size_t size) {
+  if (!stats_ || !parseRTCP(data, size, rtcp_feedback_)) {
+    return;
+  }
+  RTSPTrack& track = *tracks_[index];
+  for (const RTCPReportBlock& block : rtcp_feedback_.reports) {
+    if (block.ssrc != track.ssrc) {
+      continue;
+    }
+    ++stats_->rtcp_rr_received;
+    // 丢包、抖动和 RTT 指标只反映视频
+    if (index != kVideoTrack) {
+      continue;
+    }
+    stats_->fraction_lost = block.fraction_lost;
+    stats_->cumulative_lost = block.cumulative_lost;
+    stats_->jitter = block.jitter;
+    // RTT = 现在 - LSR - DLSR，均为 NTP 中间 32 位，单位 1/65536 秒
+    if (block.lsr != 0) {
+      uint32_t now = static_cast<uint32_t>(ntpNow() >> 16);
+      uint32_t rtt = now - block.lsr - block.dlsr;
+      if (rtt < (60u << 16)) {
+        stats_->rtt_us = static_cast<uint32_t>((uint64_t(rtt) * 1000000) >> 16);
+      }
+    }
+  }
+  if (!rtcp_feedback_.nacks.empty()) {
+    retransmit(track);
+  }
+}
+
+void RTSPSession::retransmit(RTSPTrack& track) {
+  stats_->nack_received += rtcp_feedback_.nacks.size();
+  if (!track.retransmit || !track.rtp_socket.is_open()) {
+    return;
+  }
+  retransmit_packets_.clear();
+  for (const RTCPNack& nack : rtcp_feedback_.nacks) {
+    if (nack.media_ssrc != track.ssrc) {
+      continue;
+    }
+    if (const RTPPacket* packet = track.retransmit->find(nack.seq)) {
+      retransmit_packets_.push_back(*packet);
+    }
+  }
+  if (retransmit_packets_.empty()) {
+    return;
+  }
+  // 重传不经过平滑发送，越早到达越有可能赶上解码
+  stats_->rtp_retransmitted += retransmit_packets_.size();
+  track.rtp_sender.send(retransmit_packets_, track.rtp_client_endpoint);
+}
@@ -1,25 +1,66 @@
 #pragma once
 #include <boost/asio/io_context.hpp>
-#include <fstream>
 #include <string>
+#include <string_view>
 
+#include "RTCP.h"
+#include "RTP.h"
+#include "asioioservicepool.h"
+#include "broadcasthub.h"
 #include "global.h"
+#include "mediafile.h"
+#include "metrics.h"
+#include "pacer.h"
+#include "prefetch.h"
+#include "retransmit.h"
+#include "rtpsender.h"
 class RTSPRequest {
  public:
   friend class RTSPSession;
+  friend class RTSPRequestParser;
   RTSPRequest() = default;
   ~RTSPRequest() = default;
-  int parseRequest(const std::string& req_str);
-  int parseOneLine(const std::string& line);
-  int parseRequestLine(const std::string& line);
+  // req_str 为请求行和头部，以空行结束；字符串字段都是指向 req_str 的视图
+  int parseRequest(std::string_view req_str);
+  int parseOneLine(std::string_view line);
+  int parseRequestLine(std::string_view line);
 
  private:
-  RTSPMethod method_;
-  std::string url_;
-  std::string version_;
-  std::string session_id_;
-  int seq_;
+  RTSPMethod method_ = RTSPMethod::UNKNOWN;
+  // 以下视图指向会话的接收缓冲区，只在处理这条请求期间有效
+  std::string_view url_;
+  std::string_view version_;
+  std::string_view session_id_;
+  std::string_view body_;  // SET_PARAMETER/ANNOUNCE 等带的 Content-Length 正文
+  int seq_ = 0;
+  size_t content_length_ = 0;
   uint16_t client_port_[2] = {0, 0};
+  double range_start_ = -1;  // Range: npt= 的起点（秒），-1 表示未指定
+  TransportProtocol transport_ = TransportProtocol::UDP;
+  uint8_t interleaved_[2] = {0, 1};  // TCP 交错传输的 RTP/RTCP 通道号
+};
+
+// 增量解析：在接收缓冲区上切出一条完整的请求（含正文），不做拷贝
+// 数据不完整时记住已扫描的位置，下次 async_read_some 后从那里继续查找空行
+class RTSPRequestParser {
+ public:
+  enum class Result { INCOMPLETE, COMPLETE, ERROR };
+  // data 为缓冲区中尚未处理的部分；COMPLETE 时 req 可用，consumed() 为这条消息的长度
+  Result parse(std::string_view data, RTSPRequest& req);
+  size_t consumed() const { return consumed_; }
+  // 没有解析到一半的请求，此时才可能是 $ 开头的交错数据
+  bool idle() const { return state_ == State::HEADER && scan_pos_ == 0; }
+  void reset();
+
+ private:
+  enum class State { HEADER, BODY };
+  static constexpr size_t kMaxHeaderSize = 16 * 1024;
+  static constexpr size_t kMaxBodySize = 64 * 1024;
+
+  State state_ = State::HEADER;
+  size_t scan_pos_ = 0;     // 已确认不含空行的长度
+  size_t header_size_ = 0;  // 包括结尾的空行
+  size_t consumed_ = 0;
 };
 
 class RTSPReply {
@@ -27,55 +68,138 @@ class RTSPReply {
   friend class RTSPSession;
   RTSPReply() = default;
   ~RTSPReply() = default;
-  void generateSDP();
-  std::string toString() const;
+  // 写入 out（会先清空），out 由会话复用，稳定后不再分配
+  void serialize(std::string& out) const;
 
  private:
   StatusCode status_code_;
   RTSPMethod method_;
-  uint16_t client_port_[2] = {0, 0};
-  uint16_t server_port_[2] = {0, 0};
-  std::string sdp_;
-  std::string options_;
-  std::string session_id_;
+  std::shared_ptr<const std::string> sdp_;  // 挂载点缓存的 SDP，多个会话共享
+  std::string_view content_base_;           // 请求的 URL
+  std::string_view options_;
+  std::string_view session_id_;
   int seq_;
   std::string transport_reply_;
   std::string range_;
 };
 
-class RTSPSession : public std::enable_shared_from_this<RTSPSession> {
+// 会话中的一路媒体：track0 为视频，track1 为音频，各自 SETUP，
+// 有独立的传输（UDP 端口对或交错通道）、SSRC、序号和 RTP 时钟
+struct RTSPTrack {
+  explicit RTSPTrack(net::io_context& ioc)
+      : rtp_socket(ioc), rtp_sender(rtp_socket), rtcp_socket(ioc) {}
+
+  TransportProtocol transport = TransportProtocol::UDP;
+  uint8_t interleaved[2] = {0, 1};  // TCP 交错传输的 RTP/RTCP 通道号
+  udp::socket rtp_socket;
+  udp::endpoint rtp_client_endpoint;
+  UDPBatchSender rtp_sender;
+  udp::socket rtcp_socket;
+  udp::endpoint rtcp_client_endpoint;
+  udp::endpoint rtcp_remote_endpoint;
+  std::array<uint8_t, 1500> rtcp_recv_buffer;
+  uint16_t server_rtp_port = 0;  // 从 PortAllocator 获取，RTCP 为 +1
+  std::unique_ptr<PacketPacer> packet_pacer;  // 开启平滑发送时才创建，只用于视频
+  // 收到 NACK 后从这里找回丢失的包重发，只在 UDP 传输时创建
+  std::unique_ptr<RetransmitBuffer> retransmit;
+  std::unique_ptr<RTPPacketizer> packetizer;  // PLAY 时按文件的编码创建
+  uint32_t clock_rate = 90000;
+  FramePacer pacer;
+  uint32_t rtp_timestamp = 0;  // 最近发送的帧的时间戳
+  uint32_t ssrc = 0;           // 最近发出的 RTP 包的 SSRC
+  // SR 里的包数和负载字节数，每路各自统计
+  uint32_t packet_count = 0;
+  uint32_t octet_count = 0;
+  std::chrono::steady_clock::time_point next_sr_time;
+};
+
+class RTSPSession : public std::enable_shared_from_this<RTSPSession>,
+                    public BroadcastSubscriber {
  public:
-  RTSPSession(net::io_context& ioc);
+  // socket 已经接受了连接，会话运行在它所在的 io_context 上
+  explicit RTSPSession(tcp::socket socket);
   ~RTSPSession();
   void pickRequest();
   void analysRequestAndMakeReply();
   void sendReply(const RTSPReply& reply);
   tcp::socket& Socket();
   void handleOptions(const RTSPRequest& req, RTSPReply& reply);
-  void handleDescribe(const RTSPRequest& req, RTSPReply& reply);
-  void handleSetup(const RTSPRequest& req, RTSPReply& reply);
-  void handlePlay(const RTSPRequest& req, RTSPReply& reply);
+  // 以下三个需要的文件还没打开时到线程池中打开（建索引），返回 false，
+  // 打开后重新处理这条请求
+  bool handleDescribe(const RTSPRequest& req, RTSPReply& reply);
+  bool handleSetup(const RTSPRequest& req, RTSPReply& reply);
+  bool handlePlay(const RTSPRequest& req, RTSPReply& reply);
   void handleTeardown(const RTSPRequest& req, RTSPReply& reply);
   void handleBadRequest(const RTSPRequest& req);
+  void onBroadcast(const std::shared_ptr<const RTPBatch>& batch) override;
 
  private:
+  static constexpr size_t kVideoTrack = 0;
+  static constexpr size_t kAudioTrack = 1;
+  static constexpr size_t kMaxTracks = 2;
+
+  net::io_context& ioc_;
+  // 所在 io_context 的负载计数，供新会话选择 io_context
+  AsioIOServicePool::Load* load_;
   std::string session_id_;
   tcp::socket client_socket_;
   std::string in_buffer_;
+  size_t in_offset_ = 0;  // in_buffer_ 中已处理的长度
+  RTSPRequestParser parser_;
+  // 正在线程池中打开文件时不处理后面的请求，打开后从等待的那条请求重新开始
+  bool open_pending_ = false;
+  std::string opened_path_;  // 线程池打开的结果，重新处理请求时取走一次
+  std::shared_ptr<const MediaSource> opened_source_;  // 打开失败为 nullptr
+  // 从缓存中取 path 对应的文件放到 source（失败为 nullptr），返回 true；
+  // 不在缓存中时放到线程池中打开，返回 false
+  bool findSource(const std::string& path,
+                  std::shared_ptr<const MediaSource>& source);
+  void finishOpen(const std::string& path,
+                  std::shared_ptr<const MediaSource> source);
+  std::string reply_buffer_;  // 序列化回复用，复用
   std::string read_buffer_;
-  udp::socket RTP_socket_;
-  udp::endpoint RTP_client_endpoint_;
-  udp::socket RTCP_socket_;
-  udp::endpoint RTCP_client_endpoint_;
+  // RTSP 回复和 TCP 交错传输的 RTP 数据都经过这里写到 client_socket_
+  TCPInterleavedSender tcp_sender_;
+  std::unique_ptr<RTSPTrack> tracks_[kMaxTracks];  // SETUP 时创建
+  // --- RTCP 状态变量 ---
+  std::shared_ptr<SessionStats> stats_;
+  RTCPFeedback rtcp_feedback_;
+  std::vector<RTPPacket> retransmit_packets_;
+  // 为 track 分配 UDP 端口对并开始接收 RTCP，失败返回 false
+  bool openUdpPorts(size_t index);
+  void startRtcpReceive(size_t index);
+  void handleRtcp(size_t index, const uint8_t* data, size_t size);
+  void maybeSendSenderReport(RTSPTrack& track, uint32_t rtp_timestamp);
+  void retransmit(RTSPTrack& track);
   void clearFile();
+  void closeSocket();
+  void closeRtpSocket();
 
   // --- RTP 状态变量 ---
-  uint16_t rtp_seq_ = 0;
-  uint32_t rtp_timestamp_ = 0;
-  const uint32_t rtp_ssrc_ = 0x12345678;  // 随机生成一个 SSRC
-  const int fps_ = 60;
-  std::ifstream video_file_;
+  static constexpr uint32_t kSSRC = kVideoSSRC;  // 视频的 SSRC，音频为 +1
+  std::vector<RTPPacket> packets_;  // 复用，避免每帧分配
+  // 直播模式：从 hub 接收已打包好的数据，不再自己读文件
+  std::shared_ptr<BroadcastHub> hub_;
+  bool waiting_key_ = true;
+  uint16_t broadcast_seq_ = 0;
+  uint32_t broadcast_ts_offset_ = 0;
+  const int fps_ = kVideoFps;
+  std::string media_path_;  // SETUP 时由 URL 解析出的文件
+  // 正在播放的文件；各路的帧由线程池预读，网络线程只取读好的帧
+  std::shared_ptr<const MediaSource> source_;
+  std::shared_ptr<FramePrefetcher> prefetchers_[kMaxTracks];
+  // 所有轨道共用一个定时器，每次发送呈现时间最早的那一路
   boost::asio::steady_timer timer_;
   void startRtpSending();
-  void sendOneH264Frame();
-};
\ No newline at end of file
+  // 开始预读 index 这一路，替换原来的预读
+  void startPrefetch(size_t index, FramePrefetcher::ReadFn read);
+  void stopPrefetch();
+  void scheduleNextFrame();
+  // 正在播放的轨道中下一帧最早的那一路，都已播完返回 kMaxTracks
+  size_t nextTrack() const;
+  // 返回 false 表示预读没跟上，帧读好后由预读回调重新调度
+  bool sendOneFrame(size_t index);
+  // owner 持有包负载所在的内存，is_key 表示这是关键帧
+  void sendPackets(RTSPTrack& track, const std::vector<RTPPacket>& packets,
+                   std::shared_ptr<const void> owner, bool is_key);
+};
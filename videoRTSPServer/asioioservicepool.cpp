@@ -1,16 +1,149 @@
 #include "asioioservicepool.h"
 
+#include <algorithm>
+#include <cstring>
+#include <fstream>
 #include <iostream>
+#include <map>
+#include <string>
+#include <thread>
+
+#include "config.h"
+
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+
+#include <filesystem>
+#endif
 using namespace std;
+
+namespace {
+struct CpuSlot {
+  int cpu = -1;  // -1 表示不绑定
+  int node = 0;
+};
+
+#ifdef __linux__
+// 读取 sysfs 中 cpuN 所在的 NUMA 节点，没有 NUMA 信息时都算节点 0
+int cpuNode(int cpu) {
+  std::error_code ec;
+  std::filesystem::directory_iterator it(
+      "/sys/devices/system/cpu/cpu" + std::to_string(cpu), ec);
+  for (; !ec && it != std::filesystem::directory_iterator();
+       it.increment(ec)) {
+    std::string name = it->path().filename().string();
+    if (name.size() > 4 && name.compare(0, 4, "node") == 0 &&
+        isdigit(static_cast<unsigned char>(name[4]))) {
+      return std::atoi(name.c_str() + 4);
+    }
+  }
+  return 0;
+}
+
+// 超线程的兄弟 CPU 中编号最小的那个才算物理核的第一个逻辑核
+bool isFirstSibling(int cpu) {
+  std::ifstream file("/sys/devices/system/cpu/cpu" + std::to_string(cpu) +
+                     "/topology/thread_siblings_list");
+  int first = cpu;
+  if (file >> first) {
+    return first == cpu;
+  }
+  return true;
+}
+
+// 进程可用的 CPU（受 taskset/cgroup 限制），按节点轮流排列，
+// 依次绑定时线程均匀分布到各节点；每个节点内先排物理核，再排超线程
+std::vector<CpuSlot> orderedCpus() {
+  cpu_set_t set;
+  CPU_ZERO(&set);
+  if (sched_getaffinity(0, sizeof(set), &set) != 0) {
+    return {};
+  }
+  std::map<int, std::vector<int>> by_node;
+  for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu) {
+    if (CPU_ISSET(cpu, &set)) {
+      by_node[cpuNode(cpu)].push_back(cpu);
+    }
+  }
+  for (auto& [node, cpus] : by_node) {
+    std::stable_partition(cpus.begin(), cpus.end(), isFirstSibling);
+  }
+  std::vector<CpuSlot> ordered;
+  for (size_t i = 0;; ++i) {
+    bool any = false;
+    for (auto& [node, cpus] : by_node) {
+      if (i < cpus.size()) {
+        ordered.push_back({cpus[i], node});
+        any = true;
+      }
+    }
+    if (!any) {
+      break;
+    }
+  }
+  return ordered;
+}
+
+// 在线程内部绑定，之后 io_context 运行中分配的内存按首次访问落在本节点
+void pinCurrentThread(int cpu) {
+  cpu_set_t set;
+  CPU_ZERO(&set);
+  CPU_SET(cpu, &set);
+  int ret = pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+  if (ret != 0) {
+    std::cerr << "pin io thread to cpu " << cpu << " failed: " << strerror(ret)
+              << std::endl;
+  }
+}
+#else
+std::vector<CpuSlot> orderedCpus() { return {}; }
+void pinCurrentThread(int) {}
+#endif
+
+size_t threadCount(size_t size) {
+  if (size == 0) {
+    size = ServerConfig::GetInstance()->io_threads;
+  }
+  if (size == 0) {
+    size = orderedCpus().size();
+  }
+  if (size == 0) {
+    size = std::thread::hardware_concurrency();
+  }
+  return std::max<size_t>(size, 1);
+}
+}  // namespace
+
 AsioIOServicePool::AsioIOServicePool(std::size_t size)
-    : _ioServices(size), _works(size), _nextIOService(0) {
+    : _loads(threadCount(size)),
+      _nextIOService(0),
+      _lastRateUpdate(std::chrono::steady_clock::now()) {
+  size = _loads.size();
+  std::vector<CpuSlot> cpus;
+  if (ServerConfig::GetInstance()->io_pin_threads) {
+    cpus = orderedCpus();
+  }
+  // 每个 io_context 只在一个线程中运行，并发提示为 1
   for (std::size_t i = 0; i < size; ++i) {
-    _works[i] = std::make_unique<Work>(
-        boost::asio::make_work_guard(_ioServices[i].get_executor()));
+    _ioServices.push_back(std::make_unique<IOService>(1));
+    _works.push_back(std::make_unique<Work>(
+        boost::asio::make_work_guard(_ioServices[i]->get_executor())));
   }
   // 遍历多个ioservice，创建多个线程，每个线程内部启动ioservice
+  // 线程比 CPU 多时轮流绑定，多出的线程与前面的共用一个核
   for (std::size_t i = 0; i < _ioServices.size(); ++i) {
-    _threads.emplace_back([this, i]() { _ioServices[i].run(); });
+    CpuSlot slot = cpus.empty() ? CpuSlot{} : cpus[i % cpus.size()];
+    _threads.emplace_back([this, i, slot]() {
+      if (slot.cpu >= 0) {
+        pinCurrentThread(slot.cpu);
+      }
+      _ioServices[i]->run();
+    });
+    if (slot.cpu >= 0) {
+      std::cout << "io thread " << i << " -> cpu " << slot.cpu << " node "
+                << slot.node << std::endl;
+    }
   }
 }
 AsioIOServicePool::~AsioIOServicePool() {
@@ -18,19 +151,77 @@ AsioIOServicePool::~AsioIOServicePool() {
   std::cout << "AsioIOServicePool destruct" << endl;
 }
 boost::asio::io_context& AsioIOServicePool::GetIOService() {
-  auto& service = _ioServices[_nextIOService];
-  _nextIOService = (_nextIOService + 1) % _ioServices.size();
-  return service;
+  std::lock_guard<std::mutex> lock(_mtx);
+  updateRates();
+  bool by_rate = ServerConfig::GetInstance()->io_balance == "bitrate";
+  size_t best = _nextIOService;
+  for (size_t n = 1; n < _loads.size(); ++n) {
+    size_t i = (_nextIOService + n) % _loads.size();
+    const Load& load = _loads[i];
+    const Load& current = _loads[best];
+    size_t sessions = load.sessions.load(std::memory_order_relaxed);
+    size_t best_sessions = current.sessions.load(std::memory_order_relaxed);
+    bool lighter = by_rate ? (load.rate < current.rate ||
+                              (load.rate == current.rate &&
+                               sessions < best_sessions))
+                           : (sessions < best_sessions ||
+                              (sessions == best_sessions &&
+                               load.rate < current.rate));
+    if (lighter) {
+      best = i;
+    }
+  }
+  _nextIOService = (best + 1) % _loads.size();
+  // 新会话还没开始发送，先按平均每个会话的速率记上，
+  // 否则一秒内连上的会话都会落到同一个 io_service
+  double total_rate = 0;
+  size_t total_sessions = 0;
+  for (const Load& load : _loads) {
+    total_rate += load.rate;
+    total_sessions += load.sessions.load(std::memory_order_relaxed);
+  }
+  if (total_sessions > 0) {
+    _loads[best].rate += total_rate / total_sessions;
+  }
+  return *_ioServices[best];
+}
+AsioIOServicePool::Load* AsioIOServicePool::GetLoad(
+    boost::asio::io_context& ioc) {
+  for (size_t i = 0; i < _ioServices.size(); ++i) {
+    if (_ioServices[i].get() == &ioc) {
+      return &_loads[i];
+    }
+  }
+  return nullptr;
+}
+void AsioIOServicePool::updateRates() {
+  auto now = std::chrono::steady_clock::now();
+  double seconds =
+      std::chrono::duration<double>(now - _lastRateUpdate).count();
+  if (seconds < 1.0) {
+    return;
+  }
+  _lastRateUpdate = now;
+  for (Load& load : _loads) {
+    uint64_t octets = load.octets.load(std::memory_order_relaxed);
+    load.rate = (octets - load.last_octets) / seconds;
+    load.last_octets = octets;
+  }
 }
 void AsioIOServicePool::Stop() {
   // 因为仅仅执行work.reset并不能让iocontext从run的状态中退出
   // 当iocontext已经绑定了读或写的监听事件后，还需要手动stop该服务。
   for (auto& work : _works) {
+    if (!work) {
+      continue;
+    }
     // 把服务先停止
     work->get_executor().context().stop();
     work.reset();
   }
   for (auto& t : _threads) {
-    t.join();
+    if (t.joinable()) {
+      t.join();
+    }
   }
-}
\ No newline at end of file
+}
@@ -1,5 +1,9 @@
 #pragma once
+#include <atomic>
 #include <boost/asio.hpp>
+#include <chrono>
+#include <memory>
+#include <mutex>
 #include <vector>
 
 #include "singleton.h"
@@ -11,18 +15,40 @@ class AsioIOServicePool : public Singleton<AsioIOServicePool> {
   using Work =
       boost::asio::executor_work_guard<boost::asio::io_context::executor_type>;
   using WorkPtr = std::unique_ptr<Work>;
+  // 每个 io_service 上的负载，会话创建时登记、发送时累加，选择 io_service 时比较
+  struct Load {
+    std::atomic<size_t> sessions{0};
+    std::atomic<uint64_t> octets{0};  // 累计发送的负载字节数
+    // 以下只在持有 _mtx 时访问
+    uint64_t last_octets = 0;
+    double rate = 0;  // 最近的发送速率，字节/秒
+  };
   ~AsioIOServicePool();
   AsioIOServicePool(const AsioIOServicePool&) = delete;
   AsioIOServicePool& operator=(const AsioIOServicePool&) = delete;
-  // 使用 round-robin 的方式返回一个 io_service
+  // 返回负载最轻的 io_service：按会话数或发送速率（配置项 io_balance）
   boost::asio::io_context& GetIOService();
+  // 第 index 个 io_service，用于每个线程各放一个的对象
+  boost::asio::io_context& GetIOService(size_t index) {
+    return *_ioServices[index];
+  }
+  // ioc 对应的负载，不属于本池时返回 nullptr
+  Load* GetLoad(boost::asio::io_context& ioc);
+  size_t size() const { return _ioServices.size(); }
+  const Load& load(size_t index) const { return _loads[index]; }
   void Stop();
 
  private:
-  AsioIOServicePool(
-      std::size_t size = 2 /*std::thread::hardware_concurrency()*/);
-  std::vector<IOService> _ioServices;
+  // size 为 0 时按可用的 CPU 个数
+  explicit AsioIOServicePool(std::size_t size = 0);
+  // 距上次超过一秒时重新估算各 io_service 的发送速率
+  void updateRates();
+
+  std::mutex _mtx;
+  std::vector<Load> _loads;  // 先于 io_service 构造，析构时会话还能访问
+  std::vector<std::unique_ptr<IOService>> _ioServices;
   std::vector<WorkPtr> _works;
   std::vector<std::thread> _threads;
-  std::size_t _nextIOService;
-};
\ No newline at end of file
+  std::size_t _nextIOService;  // 负载相同时从这里开始轮流
+  std::chrono::steady_clock::time_point _lastRateUpdate;
+};
@@ -0,0 +1,215 @@
+#include "audiofile.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <iostream>
+
+#include "mediafile.h"
+#include "mp4demux.h"
+
+namespace {
+// 按扩展名判断音频编码，不是音频文件返回 false
+bool audioCodecFromPath(const std::string& path, CodecId& codec) {
+  size_t dot = path.rfind('.');
+  if (dot == std::string::npos) {
+    return false;
+  }
+  std::string_view ext = std::string_view(path).substr(dot);
+  if (Utils::iequals(ext, ".aac")) {
+    codec = CodecId::AAC;
+  } else if (Utils::iequals(ext, ".pcma") || Utils::iequals(ext, ".alaw")) {
+    codec = CodecId::PCMA;
+  } else if (Utils::iequals(ext, ".pcmu") || Utils::iequals(ext, ".ulaw")) {
+    codec = CodecId::PCMU;
+  } else {
+    return false;
+  }
+  return true;
+}
+
+// ADTS 头中 sampling_frequency_index 对应的采样率
+constexpr uint32_t kAdtsSampleRates[13] = {96000, 88200, 64000, 48000, 44100,
+                                           32000, 24000, 22050, 16000, 12000,
+                                           11025, 8000,  7350};
+// G.711 每帧 20ms
+constexpr uint32_t kG711FrameSamples = 160;
+}  // namespace
+
+std::shared_ptr<const AudioSource> AudioSource::open(const std::string& path) {
+  CodecId codec;
+  if (!audioCodecFromPath(path, codec)) {
+    return nullptr;
+  }
+  std::shared_ptr<AudioSource> source(new AudioSource(path, codec));
+  if (!source->mapFile()) {
+    return nullptr;
+  }
+  if (codec == CodecId::AAC) {
+    if (!source->parseAdts()) {
+      std::cerr << "not an ADTS file: " << path << std::endl;
+      return nullptr;
+    }
+  } else {
+    source->splitG711();
+  }
+  return source;
+}
+
+std::shared_ptr<const AudioSource> AudioSource::openCompanion(
+    const std::string& video_path) {
+  size_t slash = video_path.rfind('/');
+  size_t dot = video_path.rfind('.');
+  std::string stem =
+      dot == std::string::npos || (slash != std::string::npos && dot < slash)
+          ? video_path
+          : video_path.substr(0, dot);
+  for (const char* ext : {".aac", ".pcma", ".alaw", ".pcmu", ".ulaw"}) {
+    std::string path = stem + ext;
+    if (access(path.c_str(), R_OK) == 0) {
+      return open(path);
+    }
+  }
+  return nullptr;
+}
+
+std::shared_ptr<const AudioSource> AudioSource::openMp4Track(
+    const std::string& path, const Mp4Track& track) {
+  if (track.codec != CodecId::AAC || track.audio_config.size < 2) {
+    return nullptr;
+  }
+  std::shared_ptr<AudioSource> source(new AudioSource(path, CodecId::AAC));
+  if (!source->mapFile() ||
+      track.audio_config.offset > source->size_ ||
+      track.audio_config.size > source->size_ - track.audio_config.offset) {
+    return nullptr;
+  }
+  const uint8_t* config = source->data_ + track.audio_config.offset;
+  source->config_.assign(config, config + track.audio_config.size);
+  // AudioSpecificConfig 中的采样率优先，扩展的显式采样率（索引 15）时用 mp4a 里的
+  uint8_t sf_index = ((config[0] & 0x07) << 1) | (config[1] >> 7);
+  source->clock_rate_ =
+      sf_index < 13 ? kAdtsSampleRates[sf_index] : track.sample_rate;
+  source->channels_ = (config[1] >> 3) & 0x0F;
+  if (source->channels_ == 0) {
+    source->channels_ = track.channels;
+  }
+  source->samples_per_frame_ = 1024;
+  source->frames_.reserve(track.samples.size());
+  for (const Mp4Sample& sample : track.samples) {
+    AudioFrameInfo frame;
+    frame.offset = sample.offset;
+    frame.size = sample.size;
+    source->frames_.push_back(frame);
+  }
+  return source;
+}
+
+AudioSource::AudioSource(const std::string& path, CodecId codec)
+    : path_(path), codec_(codec) {}
+
+AudioSource::~AudioSource() {
+  if (data_ != nullptr) {
+    munmap(const_cast<uint8_t*>(data_), size_);
+  }
+}
+
+bool AudioSource::mapFile() {
+  int fd = ::open(path_.c_str(), O_RDONLY);
+  if (fd < 0) {
+    std::cerr << "open audio failed: " << path_ << std::endl;
+    return false;
+  }
+  struct stat st;
+  if (fstat(fd, &st) != 0 || st.st_size == 0) {
+    ::close(fd);
+    return false;
+  }
+  void* addr = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  ::close(fd);
+  if (addr == MAP_FAILED) {
+    std::cerr << "mmap audio failed: " << path_ << std::endl;
+    return false;
+  }
+  data_ = static_cast<const uint8_t*>(addr);
+  size_ = st.st_size;
+  return true;
+}
+
+bool AudioSource::parseAdts() {
+  // ADTS 头（ISO 14496-3 1.A.2）：
+  // syncword(12) id(1) layer(2) protection_absent(1) profile(2)
+  // sampling_frequency_index(4) private(1) channel_configuration(3) ...
+  // frame_length(13) buffer_fullness(11) number_of_raw_data_blocks(2)
+  size_t pos = 0;
+  bool first = true;
+  while (pos + 7 <= size_) {
+    const uint8_t* p = data_ + pos;
+    if (p[0] != 0xFF || (p[1] & 0xF6) != 0xF0) {
+      // 不是帧头，逐字节向后找同步字
+      ++pos;
+      continue;
+    }
+    size_t header = (p[1] & 0x01) ? 7 : 9;
+    size_t length = ((p[3] & 0x03) << 11) | (p[4] << 3) | (p[5] >> 5);
+    uint8_t sf_index = (p[2] >> 2) & 0x0F;
+    if (length <= header || pos + length > size_ || sf_index >= 13) {
+      ++pos;
+      continue;
+    }
+    if (first) {
+      uint8_t object_type = (p[2] >> 6) + 1;
+      uint8_t channels = ((p[2] & 0x01) << 2) | (p[3] >> 6);
+      clock_rate_ = kAdtsSampleRates[sf_index];
+      channels_ = channels;
+      samples_per_frame_ = 1024;
+      // AudioSpecificConfig：object_type(5) sf_index(4) channels(4) 0(3)
+      config_ = {static_cast<uint8_t>((object_type << 3) | (sf_index >> 1)),
+                 static_cast<uint8_t>(((sf_index & 0x01) << 7) |
+                                      (channels << 3))};
+      first = false;
+    }
+    AudioFrameInfo frame;
+    frame.offset = pos + header;
+    frame.size = static_cast<uint32_t>(length - header);
+    frames_.push_back(frame);
+    pos += length;
+  }
+  return !frames_.empty();
+}
+
+void AudioSource::splitG711() {
+  clock_rate_ = 8000;
+  channels_ = 1;
+  samples_per_frame_ = kG711FrameSamples;
+  // 每个采样 1 字节，最后不足 20ms 的部分也作为一帧
+  for (size_t pos = 0; pos < size_; pos += kG711FrameSamples) {
+    AudioFrameInfo frame;
+    frame.offset = pos;
+    frame.size = static_cast<uint32_t>(
+        std::min<size_t>(kG711FrameSamples, size_ - pos));
+    frames_.push_back(frame);
+  }
+}
+
+bool AudioCursor::readNextFrame(std::vector<NaluView>& frames) {
+  frames.clear();
+  if (eof()) {
+    return false;
+  }
+  const AudioFrameInfo& frame = source_->frameInfo(next_frame_++);
+  frames.push_back({source_->data(frame), frame.size});
+  return true;
+}
+
+void AudioCursor::seekToTime(double seconds) {
+  if (!source_) {
+    return;
+  }
+  size_t frame = static_cast<size_t>(seconds * source_->clockRate() /
+                                     source_->samplesPerFrame());
+  next_frame_ = std::min(frame, source_->frameCount());
+}
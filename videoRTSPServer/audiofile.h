@@ -0,0 +1,87 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "global.h"
+
+struct NaluView;
+struct Mp4Track;
+
+// 音频帧在文件中的位置（AAC 不含 ADTS 头）
+struct AudioFrameInfo {
+  uint64_t offset = 0;
+  uint32_t size = 0;
+};
+
+// 映射到内存的音频文件，只读，可被任意多个会话共享
+// AAC：ADTS 封装（.aac）或 MP4 中的轨道，每帧 1024 个采样
+// G.711：无头的 8kHz 单声道 A-law（.pcma/.alaw）或 μ-law（.pcmu/.ulaw），按 20ms 一帧切分
+class AudioSource {
+ public:
+  // 按扩展名判断编码，失败返回 nullptr
+  static std::shared_ptr<const AudioSource> open(const std::string& path);
+  // 视频文件旁同名的音频文件（如 front.h264 对应 front.aac），没有返回 nullptr
+  static std::shared_ptr<const AudioSource> openCompanion(
+      const std::string& video_path);
+  // MP4 中的 AAC 轨道，帧直接指向文件中的样本
+  static std::shared_ptr<const AudioSource> openMp4Track(
+      const std::string& path, const Mp4Track& track);
+  ~AudioSource();
+  AudioSource(const AudioSource&) = delete;
+  AudioSource& operator=(const AudioSource&) = delete;
+
+  const std::string& path() const { return path_; }
+  CodecId codec() const { return codec_; }
+  // RTP 时钟频率，等于采样率
+  uint32_t clockRate() const { return clock_rate_; }
+  uint32_t channels() const { return channels_; }
+  uint32_t samplesPerFrame() const { return samples_per_frame_; }
+  size_t frameCount() const { return frames_.size(); }
+  const uint8_t* data(const AudioFrameInfo& frame) const {
+    return data_ + frame.offset;
+  }
+  const AudioFrameInfo& frameInfo(size_t index) const {
+    return frames_[index];
+  }
+  // AAC 的 AudioSpecificConfig（ISO 14496-3 1.6.2.1），SDP 的 config= 用
+  const uint8_t* config() const { return config_.data(); }
+  size_t configSize() const { return config_.size(); }
+
+ private:
+  AudioSource(const std::string& path, CodecId codec);
+  bool mapFile();
+  bool parseAdts();
+  void splitG711();
+
+  std::string path_;
+  CodecId codec_;
+  const uint8_t* data_ = nullptr;
+  size_t size_ = 0;
+  uint32_t clock_rate_ = 8000;
+  uint32_t channels_ = 1;
+  uint32_t samples_per_frame_ = 160;
+  std::vector<uint8_t> config_;
+  std::vector<AudioFrameInfo> frames_;
+};
+
+// 会话在音频源上的读取位置
+class AudioCursor {
+ public:
+  AudioCursor() = default;
+  explicit AudioCursor(std::shared_ptr<const AudioSource> source)
+      : source_(std::move(source)) {}
+  bool isOpen() const { return source_ != nullptr; }
+  bool eof() const { return !source_ || next_frame_ >= source_->frameCount(); }
+  // 读取下一帧（一个 AU）到 frames（会先清空），没有更多帧时返回 false
+  bool readNextFrame(std::vector<NaluView>& frames);
+  // 跳到 seconds 秒处的帧，与视频的 Range 对齐
+  void seekToTime(double seconds);
+  const std::shared_ptr<const AudioSource>& source() const { return source_; }
+
+ private:
+  std::shared_ptr<const AudioSource> source_;
+  size_t next_frame_ = 0;
+};
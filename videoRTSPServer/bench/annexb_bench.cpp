@@ -0,0 +1,178 @@
+// Annex-B 码流切分 NALU 的耗时对比：
+//   legacy  原来的 Nalu::readNextNalu，ifstream 逐字节读取并 push_back
+//   memchr  映射文件后用 findStartCode 扫描，MediaSource::buildIndex 的做法
+//   index   MediaSource::open 冷启动（扫描并写索引文件）和热启动（映射索引文件）
+// 用法：annexb_bench [文件.h264]，不给文件时生成 64 MiB 的合成码流
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "mediafile.h"
+
+namespace {
+// 原来的实现，只把返回值改成输出参数，逻辑保持不变
+bool legacyReadNextNalu(std::ifstream& video_file, std::vector<uint8_t>& data) {
+  data.clear();
+  if (!video_file.is_open() || video_file.eof()) {
+    return false;
+  }
+  uint8_t buf[4] = {0};
+  video_file.read((char*)buf, 3);
+  size_t read_count = video_file.gcount();
+  if (read_count < 3) return false;
+  if (buf[0] == 0 && buf[1] == 0 && buf[2] == 1) {
+  } else if (buf[0] == 0 && buf[1] == 0 && buf[2] == 0) {
+    video_file.read((char*)&buf[3], 1);
+    if (video_file.gcount() == 1 && buf[3] == 1) {
+    } else {
+      video_file.seekg(-(int)video_file.gcount(), std::ios::cur);
+    }
+  } else {
+    video_file.seekg(-3, std::ios::cur);
+  }
+  char byte;
+  int zero_count = 0;
+  while (video_file.get(byte)) {
+    data.push_back(static_cast<uint8_t>(byte));
+    if (byte == 0x00) {
+      zero_count++;
+    } else if (byte == 0x01) {
+      if (zero_count >= 2) {
+        int start_code_len = (zero_count >= 3) ? 4 : 3;
+        for (int i = 0; i < start_code_len; i++) {
+          data.pop_back();
+        }
+        video_file.seekg(-start_code_len, std::ios::cur);
+        return true;
+      }
+      zero_count = 0;
+    } else {
+      zero_count = 0;
+    }
+  }
+  return !data.empty();
+}
+
+// 合成码流：每 30 帧一个 SPS/PPS/IDR，其余为 P 帧，负载不含 0，不会出现伪起始码
+void writeSynthetic(const std::string& path, size_t total) {
+  std::mt19937 gen(1);
+  std::uniform_int_distribution<int> byte(1, 255);
+  std::uniform_int_distribution<size_t> frame_size(2000, 60000);
+  std::vector<uint8_t> out;
+  out.reserve(total + 65536);
+  auto nalu = [&](uint8_t header, size_t size) {
+    static const uint8_t kStartCode[4] = {0, 0, 0, 1};
+    out.insert(out.end(), kStartCode, kStartCode + 4);
+    out.push_back(header);
+    out.push_back(0x80);  // first_mb_in_slice == 0
+    for (size_t i = 2; i < size; ++i) {
+      out.push_back(static_cast<uint8_t>(byte(gen)));
+    }
+  };
+  for (size_t frame = 0; out.size() < total; ++frame) {
+    if (frame % 30 == 0) {
+      nalu(0x67, 16);
+      nalu(0x68, 6);
+      nalu(0x65, frame_size(gen) * 4);
+    } else {
+      nalu(0x41, frame_size(gen));
+    }
+  }
+  std::ofstream file(path, std::ios::binary | std::ios::trunc);
+  file.write(reinterpret_cast<const char*>(out.data()), out.size());
+}
+
+double secondsSince(std::chrono::steady_clock::time_point begin) {
+  return std::chrono::duration<double>(std::chrono::steady_clock::now() -
+                                       begin)
+      .count();
+}
+
+void report(const char* name, size_t nalus, size_t bytes, double seconds) {
+  printf("%-14s %8zu nalus %10.1f MB/s %10.3f ms\n", name, nalus,
+         bytes / seconds / 1e6, seconds * 1000);
+}
+}  // namespace
+
+int main(int argc, char* argv[]) {
+  std::string path;
+  bool synthetic = argc < 2;
+  if (synthetic) {
+    path = "/tmp/annexb_bench.h264";
+    writeSynthetic(path, 64 << 20);
+  } else {
+    path = argv[1];
+  }
+  struct stat st;
+  if (stat(path.c_str(), &st) != 0) {
+    fprintf(stderr, "can not open %s\n", path.c_str());
+    return 1;
+  }
+  size_t file_size = st.st_size;
+
+  // 1. 原来的逐字节读取
+  {
+    std::ifstream file(path, std::ios::binary);
+    std::vector<uint8_t> data;
+    size_t count = 0;
+    auto begin = std::chrono::steady_clock::now();
+    while (legacyReadNextNalu(file, data)) {
+      ++count;
+    }
+    report("legacy", count, file_size, secondsSince(begin));
+  }
+
+  // 2. 映射后 memchr 扫描起始码
+  {
+    int fd = ::open(path.c_str(), O_RDONLY);
+    void* addr = mmap(nullptr, file_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (addr == MAP_FAILED) {
+      fprintf(stderr, "mmap failed\n");
+      return 1;
+    }
+    const uint8_t* data = static_cast<const uint8_t*>(addr);
+    const uint8_t* end = data + file_size;
+    size_t count = 0;
+    auto begin = std::chrono::steady_clock::now();
+    const uint8_t* sc = findStartCode(data, end);
+    while (sc != end) {
+      const uint8_t* next = findStartCode(sc + 3, end);
+      ++count;
+      sc = next;
+    }
+    report("memchr", count, file_size, secondsSince(begin));
+    munmap(addr, file_size);
+  }
+
+  // 3. 完整的建索引，以及下次启动直接映射索引文件
+  std::string index_path = path + ".idx";
+  unlink(index_path.c_str());
+  {
+    auto begin = std::chrono::steady_clock::now();
+    auto source = MediaSource::open(path);
+    double seconds = secondsSince(begin);
+    report("index cold", source ? source->naluCount() : 0, file_size,
+           seconds);
+  }
+  {
+    auto begin = std::chrono::steady_clock::now();
+    auto source = MediaSource::open(path);
+    double seconds = secondsSince(begin);
+    report("index warm", source ? source->naluCount() : 0, file_size,
+           seconds);
+  }
+  if (synthetic) {
+    unlink(index_path.c_str());
+    unlink(path.c_str());
+  }
+  return 0;
+}
@@ -0,0 +1,198 @@
+#pragma once
+// 基准测试用：在子进程中按给定配置启动服务器（与 main 相同的启动流程），
+// 父进程作为客户端连接它；以及简单的阻塞式 RTSP 请求
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sched.h>
+#include <sys/socket.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <functional>
+#include <iterator>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "RTSPserver.h"
+#include "asioioservicepool.h"
+#include "config.h"
+#include "mediacatalog.h"
+
+namespace bench {
+// 进程可用的 CPU 编号
+inline std::vector<int> allowedCpus() {
+  cpu_set_t set;
+  CPU_ZERO(&set);
+  std::vector<int> cpus;
+  if (sched_getaffinity(0, sizeof(set), &set) == 0) {
+    for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu) {
+      if (CPU_ISSET(cpu, &set)) {
+        cpus.push_back(cpu);
+      }
+    }
+  }
+  return cpus;
+}
+
+inline void pinProcess(const std::vector<int>& cpus) {
+  if (cpus.empty()) {
+    return;
+  }
+  cpu_set_t set;
+  CPU_ZERO(&set);
+  for (int cpu : cpus) {
+    CPU_SET(cpu, &set);
+  }
+  sched_setaffinity(0, sizeof(set), &set);
+}
+
+// fork 出服务器进程，setup 在子进程中修改配置；返回子进程号，失败返回 -1
+// 子进程的输出丢弃，由父进程用 stopServer 结束
+inline pid_t startServer(const std::function<void(ServerConfig&)>& setup) {
+  pid_t pid = fork();
+  if (pid != 0) {
+    return pid;
+  }
+  int null_fd = ::open("/dev/null", O_WRONLY);
+  if (null_fd >= 0) {
+    dup2(null_fd, STDOUT_FILENO);
+    dup2(null_fd, STDERR_FILENO);
+    ::close(null_fd);
+  }
+  try {
+    auto config = ServerConfig::GetInstance();
+    setup(*config);
+    MediaCatalog::GetInstance()->add("live", config->media_path);
+    net::io_context ioc{1};
+    if (config->reuseport_acceptors) {
+      auto pool = AsioIOServicePool::GetInstance();
+      for (size_t i = 0; i < pool->size(); ++i) {
+        std::make_shared<RTSPServer>(pool->GetIOService(i), config->port, true)
+            ->start();
+      }
+    } else {
+      std::make_shared<RTSPServer>(ioc, config->port)->start();
+    }
+    auto work = net::make_work_guard(ioc);
+    ioc.run();
+  } catch (std::exception&) {
+  }
+  _exit(1);
+}
+
+inline void stopServer(pid_t pid) {
+  kill(pid, SIGKILL);
+  waitpid(pid, nullptr, 0);
+}
+
+// 进程累计的用户态 + 内核态 CPU 秒数，读取 /proc/<pid>/stat
+inline double processCpuSeconds(pid_t pid) {
+  std::ifstream file("/proc/" + std::to_string(pid) + "/stat");
+  std::string stat((std::istreambuf_iterator<char>(file)),
+                   std::istreambuf_iterator<char>());
+  // 进程名可能带空格，从最后一个 ')' 之后数：state 为第 3 项，utime/stime 为第 14/15 项
+  size_t pos = stat.rfind(')');
+  if (pos == std::string::npos) {
+    return 0;
+  }
+  std::vector<std::string> fields;
+  size_t begin = pos + 2;
+  while (begin < stat.size()) {
+    size_t end = stat.find(' ', begin);
+    fields.push_back(stat.substr(begin, end - begin));
+    if (end == std::string::npos) {
+      break;
+    }
+    begin = end + 1;
+  }
+  if (fields.size() < 13) {
+    return 0;
+  }
+  return (std::stod(fields[11]) + std::stod(fields[12])) /
+         sysconf(_SC_CLK_TCK);
+}
+
+// 连接 127.0.0.1:port，失败返回 -1
+inline int connectTo(uint16_t port) {
+  int fd = socket(AF_INET, SOCK_STREAM, 0);
+  if (fd < 0) {
+    return -1;
+  }
+  sockaddr_in addr{};
+  addr.sin_family = AF_INET;
+  addr.sin_port = htons(port);
+  addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  if (connect(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0) {
+    ::close(fd);
+    return -1;
+  }
+  int one = 1;
+  setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+  return fd;
+}
+
+// 等服务器开始监听，超时返回 false
+inline bool waitForServer(uint16_t port, std::chrono::seconds timeout) {
+  auto deadline = std::chrono::steady_clock::now() + timeout;
+  while (std::chrono::steady_clock::now() < deadline) {
+    int fd = connectTo(port);
+    if (fd >= 0) {
+      ::close(fd);
+      return true;
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+  }
+  return false;
+}
+
+// 发送一条请求并读取回复（含 Content-Length 的消息体），失败返回空串
+inline std::string request(int fd, const std::string& text) {
+  if (send(fd, text.data(), text.size(), MSG_NOSIGNAL) !=
+      static_cast<ssize_t>(text.size())) {
+    return {};
+  }
+  std::string reply;
+  char buf[4096];
+  size_t header_end = std::string::npos;
+  size_t total = 0;
+  while (header_end == std::string::npos || reply.size() < total) {
+    ssize_t n = recv(fd, buf, sizeof(buf), 0);
+    if (n <= 0) {
+      return {};
+    }
+    reply.append(buf, n);
+    if (header_end == std::string::npos) {
+      header_end = reply.find("\r\n\r\n");
+      if (header_end != std::string::npos) {
+        total = header_end + 4;
+        size_t length = reply.find("Content-Length: ");
+        if (length != std::string::npos && length < header_end) {
+          total += std::strtoul(reply.c_str() + length + 16, nullptr, 10);
+        }
+      }
+    }
+  }
+  return reply;
+}
+
+// 回复中某个头部的值（到 ';' 或行尾），没有返回空串
+inline std::string header(const std::string& reply, const std::string& name) {
+  size_t pos = reply.find(name + ": ");
+  if (pos == std::string::npos) {
+    return {};
+  }
+  pos += name.size() + 2;
+  size_t end = reply.find_first_of(";\r\n", pos);
+  return reply.substr(pos, end - pos);
+}
+}  // namespace bench
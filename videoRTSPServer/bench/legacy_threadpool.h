@@ -0,0 +1,109 @@
+#pragma once
+// 改造前的线程池（加锁的 std::queue + std::function + packaged_task），
+// 只用于 threadpool_bench 对比；逻辑保持原样，只是去掉了单例、放进 legacy 命名空间
+#include <condition_variable>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <vector>
+
+namespace legacy {
+template <typename T>
+class TaskQueue {
+ public:
+  bool empty() {
+    std::lock_guard<std::mutex> lock(mtx_);
+    return queue_.empty();
+  }
+  void enqueue(const T& item) {
+    std::lock_guard<std::mutex> lock(mtx_);
+    queue_.emplace(item);
+  }
+  bool dequeue(T& item) {
+    std::lock_guard<std::mutex> lock(mtx_);
+    if (queue_.empty()) {
+      return false;
+    }
+    item = std::move(queue_.front());
+    queue_.pop();
+    return true;
+  }
+
+ private:
+  std::queue<T> queue_;
+  std::mutex mtx_;
+};
+
+class ThreadPool {
+ public:
+  explicit ThreadPool(size_t numThreads = 6)
+      : workers_(numThreads), shutdown_(false) {
+    init();
+  }
+  ~ThreadPool() {
+    if (!shutdown_) {
+      shutdown();
+    }
+  }
+  template <typename F, typename... Args>
+  auto submit(F&& f, Args&&... args) -> std::future<decltype(f(args...))> {
+    using func_type = decltype(f(args...))();
+    auto task_ptr = std::make_shared<std::packaged_task<func_type>>(
+        [f, args...]() { return f(args...); });
+    std::function<void()> wrapper_func = [task_ptr]() { (*task_ptr)(); };
+    tasks_.enqueue(wrapper_func);
+    condition_lock_.notify_one();
+    return task_ptr->get_future();
+  }
+  void shutdown() {
+    if (shutdown_) {
+      return;
+    }
+    {
+      std::lock_guard<std::mutex> lock(mtx_);
+      shutdown_ = true;
+    }
+    condition_lock_.notify_all();
+    for (auto& worker : workers_) {
+      if (worker.joinable()) {
+        worker.join();
+      }
+    }
+  }
+
+ private:
+  void init() {
+    for (size_t i = 0; i < workers_.size(); ++i) {
+      workers_[i] = std::thread([this]() {
+        std::function<void()> func;
+        bool dequeued = false;
+        while (true) {
+          {
+            std::unique_lock<std::mutex> lock(mtx_);
+            if (tasks_.empty()) {
+              condition_lock_.wait(
+                  lock, [this]() { return shutdown_ || !tasks_.empty(); });
+            }
+            if (shutdown_ && tasks_.empty()) {
+              return;
+            }
+            dequeued = tasks_.dequeue(func);
+          }
+          if (dequeued) {
+            func();
+          }
+        }
+      });
+    }
+  }
+
+  TaskQueue<std::function<void()>> tasks_;
+  std::vector<std::thread> workers_;
+  bool shutdown_;
+  std::mutex mtx_;
+  std::condition_variable condition_lock_;
+};
+}  // namespace legacy
@@ -0,0 +1,194 @@
+// RTSPRequestParser 的吞吐和随机测试
+//   吞吐：流水线发送的一批请求按不同大小切块喂给解析器，与会话的读循环一致
+//   随机：对正常请求做随机改动、随机切块，检查不会越界、切法不影响解析结果，
+//         并且超长头部报错之后下一条请求仍能正常解析
+// 用法：parser_bench [随机测试轮数]，建议用 -fsanitize=address 编译后运行
+#include <chrono>
+#include <cstdio>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "RTSPsession.h"
+
+namespace {
+const char* const kRequests[] = {
+    "OPTIONS rtsp://127.0.0.1:8554/live RTSP/1.0\r\nCSeq: 1\r\n"
+    "User-Agent: bench\r\n\r\n",
+    "DESCRIBE rtsp://127.0.0.1:8554/live RTSP/1.0\r\nCSeq: 2\r\n"
+    "Accept: application/sdp\r\n\r\n",
+    "SETUP rtsp://127.0.0.1:8554/live/track0 RTSP/1.0\r\nCSeq: 3\r\n"
+    "Transport: RTP/AVP;unicast;client_port=50000-50001\r\n\r\n",
+    "PLAY rtsp://127.0.0.1:8554/live RTSP/1.0\r\nCSeq: 4\r\nSession: 1234ABCD\r\n"
+    "Range: npt=0.000-\r\n\r\n",
+    "SET_PARAMETER rtsp://127.0.0.1:8554/live RTSP/1.0\r\nCSeq: 5\r\n"
+    "Session: 1234ABCD\r\nContent-Length: 10\r\n\r\nkey: value",
+};
+
+// 每次解析的结果：COMPLETE 时为消息长度，ERROR 为 -1
+using Trace = std::vector<long>;
+
+// 与 RTSPSession::analysRequestAndMakeReply 相同的读循环：
+// 追加到缓冲区，解析出完整的消息，出错时丢弃缓冲区
+class Feeder {
+ public:
+  void feed(std::string_view chunk, Trace* trace) {
+    buffer_.append(chunk);
+    while (offset_ < buffer_.size()) {
+      std::string_view data(buffer_.data() + offset_, buffer_.size() - offset_);
+      RTSPRequest req;
+      auto result = parser_.parse(data, req);
+      if (result == RTSPRequestParser::Result::INCOMPLETE) {
+        break;
+      }
+      if (result == RTSPRequestParser::Result::ERROR) {
+        if (trace) trace->push_back(-1);
+        buffer_.clear();
+        offset_ = 0;
+        return;
+      }
+      if (parser_.consumed() == 0 || parser_.consumed() > data.size()) {
+        fprintf(stderr, "bad consumed %zu of %zu\n", parser_.consumed(),
+                data.size());
+        std::abort();
+      }
+      if (trace) trace->push_back(static_cast<long>(parser_.consumed()));
+      offset_ += parser_.consumed();
+      ++messages_;
+    }
+    if (offset_ > 0) {
+      buffer_.erase(0, offset_);
+      offset_ = 0;
+    }
+  }
+  size_t messages() const { return messages_; }
+
+ private:
+  RTSPRequestParser parser_;
+  std::string buffer_;
+  size_t offset_ = 0;
+  size_t messages_ = 0;
+};
+
+Trace feedInChunks(const std::string& stream, std::mt19937& gen,
+                   size_t max_chunk) {
+  std::uniform_int_distribution<size_t> chunk(1, max_chunk);
+  Feeder feeder;
+  Trace trace;
+  for (size_t pos = 0; pos < stream.size();) {
+    size_t n = std::min(chunk(gen), stream.size() - pos);
+    feeder.feed(std::string_view(stream).substr(pos, n), &trace);
+    pos += n;
+  }
+  return trace;
+}
+
+void throughput() {
+  std::string stream;
+  for (int i = 0; i < 2000; ++i) {
+    for (const char* req : kRequests) {
+      stream += req;
+    }
+  }
+  const size_t chunks[] = {stream.size(), 4096, 1460, 64, 7};
+  for (size_t chunk : chunks) {
+    Feeder feeder;
+    auto begin = std::chrono::steady_clock::now();
+    int rounds = chunk < 64 ? 5 : 50;
+    for (int round = 0; round < rounds; ++round) {
+      for (size_t pos = 0; pos < stream.size(); pos += chunk) {
+        feeder.feed(std::string_view(stream).substr(pos, chunk), nullptr);
+      }
+    }
+    double seconds = std::chrono::duration<double>(
+                         std::chrono::steady_clock::now() - begin)
+                         .count();
+    printf("chunk %7zu: %10.0f req/s %8.1f MB/s\n", chunk,
+           feeder.messages() / seconds,
+           stream.size() * rounds / seconds / 1e6);
+  }
+}
+
+// 随机改动一条请求：替换、插入、删除字节，或者插入随机的 CRLF
+std::string mutate(std::string s, std::mt19937& gen) {
+  std::uniform_int_distribution<int> op(0, 4);
+  std::uniform_int_distribution<int> byte(0, 255);
+  int edits = std::uniform_int_distribution<int>(0, 4)(gen);
+  for (int i = 0; i < edits && !s.empty(); ++i) {
+    size_t pos = std::uniform_int_distribution<size_t>(0, s.size() - 1)(gen);
+    switch (op(gen)) {
+      case 0:
+        s[pos] = static_cast<char>(byte(gen));
+        break;
+      case 1:
+        s.insert(pos, 1, static_cast<char>(byte(gen)));
+        break;
+      case 2:
+        s.erase(pos, 1);
+        break;
+      case 3:
+        s.insert(pos, "\r\n");
+        break;
+      default:
+        s.insert(pos, "Content-Length: " + std::to_string(byte(gen)) + "\r\n");
+        break;
+    }
+  }
+  return s;
+}
+
+bool fuzz(int iterations) {
+  std::mt19937 gen(12345);
+  std::uniform_int_distribution<size_t> pick(0, std::size(kRequests) - 1);
+  for (int i = 0; i < iterations; ++i) {
+    std::string stream;
+    int count = std::uniform_int_distribution<int>(1, 8)(gen);
+    for (int j = 0; j < count; ++j) {
+      stream += mutate(kRequests[pick(gen)], gen);
+    }
+    // 整块喂入和随机切块的结果应当一致（出错后的数据被丢弃，只比到第一次出错）
+    Trace whole = feedInChunks(stream, gen, stream.size());
+    Trace split = feedInChunks(stream, gen, 32);
+    auto cut = [](Trace& trace) {
+      for (size_t k = 0; k < trace.size(); ++k) {
+        if (trace[k] < 0) {
+          trace.resize(k);
+          break;
+        }
+      }
+    };
+    cut(whole);
+    cut(split);
+    if (whole != split) {
+      fprintf(stderr, "split changed the result at iteration %d\n", i);
+      return false;
+    }
+  }
+
+  // 超长的头部报错后，下一条请求要能立即解析出来
+  Feeder feeder;
+  Trace trace;
+  feeder.feed(std::string(20 * 1024, 'A'), &trace);
+  std::string next = kRequests[0];
+  feeder.feed(next, &trace);
+  if (trace.size() != 2 || trace[0] != -1 ||
+      trace[1] != static_cast<long>(next.size())) {
+    fprintf(stderr, "request after an oversized header was not parsed\n");
+    return false;
+  }
+  return true;
+}
+}  // namespace
+
+int main(int argc, char* argv[]) {
+  int iterations = argc > 1 ? std::atoi(argv[1]) : 20000;
+  throughput();
+  // 解析器把每个格式错误都打印到 std::cerr，随机测试时关掉
+  std::streambuf* cerr_buf = std::cerr.rdbuf(nullptr);
+  bool ok = fuzz(iterations);
+  std::cerr.rdbuf(cerr_buf);
+  std::cerr.clear();
+  printf("fuzz %d iterations: %s\n", iterations, ok ? "ok" : "FAILED");
+  return ok ? 0 : 1;
+}
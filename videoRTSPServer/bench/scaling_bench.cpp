@@ -0,0 +1,189 @@
+// 多核扩展：网络线程数从 1 到 N，同样数量的 UDP 会话下服务器的 CPU 占用和丢包
+//   每一档在子进程中启动服务器，io_threads = k 并限制在 k 个核上；
+//   本进程建立若干个会话（SETUP + PLAY），收包统计序号缺口，
+//   测量窗口内读取服务器进程的 CPU 时间，换算成每 Gbit/s 需要的核数
+//   客户端固定在最后一个可用核上，服务器用其余的核（只有一个核时共用）
+// 用法：scaling_bench <文件.h264> [会话数] [每档秒数] [最多核数] [reuseport]
+#include <sys/epoll.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "bench_server.h"
+
+namespace {
+struct Session {
+  int control = -1;
+  int rtp = -1;
+  int expected_seq = -1;
+  uint64_t packets = 0;
+  uint64_t bytes = 0;
+  uint64_t lost = 0;
+};
+
+bool openSession(uint16_t port, Session& session) {
+  session.control = bench::connectTo(port);
+  session.rtp = socket(AF_INET, SOCK_DGRAM | SOCK_NONBLOCK, 0);
+  if (session.control < 0 || session.rtp < 0) {
+    return false;
+  }
+  int buffer = 4 << 20;
+  setsockopt(session.rtp, SOL_SOCKET, SO_RCVBUF, &buffer, sizeof(buffer));
+  sockaddr_in addr{};
+  addr.sin_family = AF_INET;
+  addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  socklen_t len = sizeof(addr);
+  if (bind(session.rtp, reinterpret_cast<sockaddr*>(&addr), len) != 0 ||
+      getsockname(session.rtp, reinterpret_cast<sockaddr*>(&addr), &len) !=
+          0) {
+    return false;
+  }
+  int client_port = ntohs(addr.sin_port);
+  std::string url = "rtsp://127.0.0.1:" + std::to_string(port) + "/live";
+  std::string reply = bench::request(
+      session.control,
+      "SETUP " + url + "/track0 RTSP/1.0\r\nCSeq: 1\r\n"
+      "Transport: RTP/AVP;unicast;client_port=" +
+          std::to_string(client_port) + "-" + std::to_string(client_port + 1) +
+          "\r\n\r\n");
+  std::string id = bench::header(reply, "Session");
+  if (reply.compare(0, 15, "RTSP/1.0 200 OK") != 0 || id.empty()) {
+    return false;
+  }
+  reply = bench::request(session.control,
+                         "PLAY " + url + " RTSP/1.0\r\nCSeq: 2\r\nSession: " +
+                             id + "\r\n\r\n");
+  return reply.compare(0, 15, "RTSP/1.0 200 OK") == 0;
+}
+
+void closeSession(Session& session) {
+  if (session.control >= 0) {
+    ::close(session.control);
+  }
+  if (session.rtp >= 0) {
+    ::close(session.rtp);
+  }
+}
+
+// 读完 fd 上所有的包，按 RTP 序号统计丢包
+void drain(Session& session, bool count) {
+  uint8_t buf[2048];
+  ssize_t n;
+  while ((n = recv(session.rtp, buf, sizeof(buf), 0)) >= 12) {
+    int seq = (buf[2] << 8) | buf[3];
+    if (count) {
+      ++session.packets;
+      session.bytes += n;
+      if (session.expected_seq >= 0) {
+        uint16_t gap = static_cast<uint16_t>(seq - session.expected_seq);
+        if (gap < 0x8000) {
+          session.lost += gap;
+        }
+      }
+    }
+    session.expected_seq = (seq + 1) & 0xFFFF;
+  }
+}
+
+// 在 duration 内收包；count 为 false 时只读不计，用于预热
+void receive(std::vector<Session>& sessions, int epoll_fd,
+             std::chrono::duration<double> duration, bool count) {
+  epoll_event events[64];
+  auto deadline = std::chrono::steady_clock::now() + duration;
+  while (std::chrono::steady_clock::now() < deadline) {
+    int n = epoll_wait(epoll_fd, events, 64, 10);
+    for (int i = 0; i < n; ++i) {
+      drain(sessions[events[i].data.u32], count);
+    }
+  }
+}
+}  // namespace
+
+int main(int argc, char* argv[]) {
+  if (argc < 2) {
+    fprintf(stderr,
+            "usage: scaling_bench <file.h264> [sessions] [seconds] "
+            "[max cores] [reuseport]\n");
+    return 1;
+  }
+  std::string media = argv[1];
+  size_t session_count = argc > 2 ? std::strtoul(argv[2], nullptr, 10) : 64;
+  double seconds = argc > 3 ? std::atof(argv[3]) : 5;
+  std::vector<int> cpus = bench::allowedCpus();
+  std::vector<int> client_cpu(cpus.end() - std::min<size_t>(cpus.size(), 1),
+                              cpus.end());
+  if (cpus.size() > 1) {
+    cpus.pop_back();
+  }
+  size_t max_cores = argc > 4 ? std::strtoul(argv[4], nullptr, 10) : 0;
+  if (max_cores == 0 || max_cores > cpus.size()) {
+    max_cores = cpus.size();
+  }
+  bool reuseport = argc > 5 && std::string(argv[5]) == "reuseport";
+  bench::pinProcess(client_cpu);
+  printf("%zu sessions, %.1f s per step, up to %zu cores, %s acceptor\n",
+         session_count, seconds, max_cores,
+         reuseport ? "reuseport" : "single");
+
+  for (size_t cores = 1; cores <= max_cores; ++cores) {
+    uint16_t port = static_cast<uint16_t>(18600 + cores);
+    std::vector<int> server_cpus(cpus.begin(), cpus.begin() + cores);
+    pid_t pid = bench::startServer([&](ServerConfig& config) {
+      bench::pinProcess(server_cpus);
+      config.port = port;
+      config.media_path = media;
+      config.io_threads = cores;
+      config.reuseport_acceptors = reuseport;
+    });
+    if (pid < 0 || !bench::waitForServer(port, std::chrono::seconds(30))) {
+      fprintf(stderr, "server on port %u did not start\n", port);
+      if (pid > 0) {
+        bench::stopServer(pid);
+      }
+      return 1;
+    }
+    std::vector<Session> sessions(session_count);
+    int epoll_fd = epoll_create1(0);
+    size_t opened = 0;
+    for (size_t i = 0; i < sessions.size(); ++i) {
+      if (!openSession(port, sessions[i])) {
+        break;
+      }
+      epoll_event event{};
+      event.events = EPOLLIN;
+      event.data.u32 = static_cast<uint32_t>(i);
+      epoll_ctl(epoll_fd, EPOLL_CTL_ADD, sessions[i].rtp, &event);
+      ++opened;
+    }
+    // 预热一秒，等所有会话的预读和发送进入稳定状态
+    receive(sessions, epoll_fd, std::chrono::seconds(1), false);
+    double cpu_begin = bench::processCpuSeconds(pid);
+    auto begin = std::chrono::steady_clock::now();
+    receive(sessions, epoll_fd, std::chrono::duration<double>(seconds), true);
+    double elapsed = std::chrono::duration<double>(
+                         std::chrono::steady_clock::now() - begin)
+                         .count();
+    double cpu = bench::processCpuSeconds(pid) - cpu_begin;
+    uint64_t packets = 0, bytes = 0, lost = 0;
+    for (Session& session : sessions) {
+      packets += session.packets;
+      bytes += session.bytes;
+      lost += session.lost;
+      closeSession(session);
+    }
+    ::close(epoll_fd);
+    bench::stopServer(pid);
+    double gbps = bytes * 8 / elapsed / 1e9;
+    printf("%2zu cores %4zu sessions %9.3f Gbit/s  loss %6.3f%%  "
+           "server cpu %5.2f cores  %6.3f cores per Gbit/s\n",
+           cores, opened, gbps,
+           packets + lost ? 100.0 * lost / (packets + lost) : 0.0,
+           cpu / elapsed, gbps > 0 ? cpu / elapsed / gbps : 0.0);
+  }
+  return 0;
+}
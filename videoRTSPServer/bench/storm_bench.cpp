@@ -0,0 +1,176 @@
+// 连接风暴：大量客户端同时连接并各发一个 OPTIONS，从开始连接到全部收到回复的时间
+//   分别测单个监听（连接到来后选择 io_context）和每个网络线程一个 SO_REUSEPORT 监听，
+//   每种方式在子进程中启动服务器，重复若干轮，给出总耗时的中位数
+//   以及单个连接（连接 + OPTIONS + 回复）延迟的 p50/p99
+// 用法：storm_bench [连接数] [网络线程数] [轮数]
+#include <sys/epoll.h>
+#include <sys/resource.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "bench_server.h"
+
+namespace {
+using Clock = std::chrono::steady_clock;
+
+struct Round {
+  double total_ms = 0;
+  std::vector<double> latency_ms;  // 每个连接从发起连接到收到回复
+  size_t failed = 0;
+};
+
+Round storm(uint16_t port, size_t count) {
+  const std::string options = "OPTIONS rtsp://127.0.0.1:" +
+                              std::to_string(port) +
+                              "/live RTSP/1.0\r\nCSeq: 1\r\n\r\n";
+  struct Conn {
+    int fd = -1;
+    bool sent = false;
+    std::string reply;
+    Clock::time_point begin;
+  };
+  std::vector<Conn> conns(count);
+  int epoll_fd = epoll_create1(0);
+  Round round;
+  auto begin = Clock::now();
+  sockaddr_in addr{};
+  addr.sin_family = AF_INET;
+  addr.sin_port = htons(port);
+  addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  size_t pending = 0;
+  for (size_t i = 0; i < count; ++i) {
+    Conn& conn = conns[i];
+    conn.begin = Clock::now();
+    conn.fd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK, 0);
+    if (conn.fd < 0) {
+      ++round.failed;
+      continue;
+    }
+    connect(conn.fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr));
+    epoll_event event{};
+    event.events = EPOLLOUT | EPOLLIN;
+    event.data.u32 = static_cast<uint32_t>(i);
+    epoll_ctl(epoll_fd, EPOLL_CTL_ADD, conn.fd, &event);
+    ++pending;
+  }
+  epoll_event events[256];
+  while (pending > 0) {
+    int n = epoll_wait(epoll_fd, events, 256, 5000);
+    if (n <= 0) {
+      // 5 秒没有任何进展，剩下的算作失败
+      round.failed += pending;
+      break;
+    }
+    for (int i = 0; i < n; ++i) {
+      Conn& conn = conns[events[i].data.u32];
+      bool done = false;
+      if (events[i].events & (EPOLLERR | EPOLLHUP)) {
+        ++round.failed;
+        done = true;
+      } else if (!conn.sent && (events[i].events & EPOLLOUT)) {
+        conn.sent = true;
+        send(conn.fd, options.data(), options.size(), MSG_NOSIGNAL);
+        epoll_event event{};
+        event.events = EPOLLIN;
+        event.data.u32 = events[i].data.u32;
+        epoll_ctl(epoll_fd, EPOLL_CTL_MOD, conn.fd, &event);
+      } else if (events[i].events & EPOLLIN) {
+        char buf[4096];
+        ssize_t got = recv(conn.fd, buf, sizeof(buf), 0);
+        if (got <= 0) {
+          ++round.failed;
+          done = true;
+        } else {
+          conn.reply.append(buf, got);
+          if (conn.reply.find("\r\n\r\n") != std::string::npos) {
+            round.latency_ms.push_back(
+                std::chrono::duration<double, std::milli>(Clock::now() -
+                                                          conn.begin)
+                    .count());
+            done = true;
+          }
+        }
+      }
+      if (done) {
+        epoll_ctl(epoll_fd, EPOLL_CTL_DEL, conn.fd, nullptr);
+        --pending;
+      }
+    }
+  }
+  round.total_ms =
+      std::chrono::duration<double, std::milli>(Clock::now() - begin).count();
+  for (Conn& conn : conns) {
+    if (conn.fd >= 0) {
+      ::close(conn.fd);
+    }
+  }
+  ::close(epoll_fd);
+  return round;
+}
+
+double percentile(std::vector<double>& values, double q) {
+  if (values.empty()) {
+    return 0;
+  }
+  std::sort(values.begin(), values.end());
+  return values[std::min(values.size() - 1,
+                         static_cast<size_t>(values.size() * q))];
+}
+}  // namespace
+
+int main(int argc, char* argv[]) {
+  size_t count = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 1000;
+  size_t threads = argc > 2 ? std::strtoul(argv[2], nullptr, 10) : 4;
+  size_t rounds = argc > 3 ? std::strtoul(argv[3], nullptr, 10) : 5;
+  if (count == 0 || threads == 0 || rounds == 0) {
+    fprintf(stderr, "usage: storm_bench [connections] [io threads] [rounds]\n");
+    return 1;
+  }
+  // 客户端和服务器各要 count 个描述符，子进程继承这里的上限
+  rlimit limit;
+  if (getrlimit(RLIMIT_NOFILE, &limit) == 0) {
+    limit.rlim_cur = limit.rlim_max;
+    setrlimit(RLIMIT_NOFILE, &limit);
+  }
+  printf("%zu connections, %zu io threads, %zu rounds\n", count, threads,
+         rounds);
+  for (bool reuseport : {false, true}) {
+    uint16_t port = reuseport ? 18702 : 18701;
+    pid_t pid = bench::startServer([&](ServerConfig& config) {
+      config.port = port;
+      config.io_threads = threads;
+      config.reuseport_acceptors = reuseport;
+    });
+    if (pid < 0 || !bench::waitForServer(port, std::chrono::seconds(10))) {
+      fprintf(stderr, "server on port %u did not start\n", port);
+      if (pid > 0) {
+        bench::stopServer(pid);
+      }
+      return 1;
+    }
+    std::vector<double> totals;
+    std::vector<double> latency;
+    size_t failed = 0;
+    for (size_t i = 0; i < rounds; ++i) {
+      Round round = storm(port, count);
+      totals.push_back(round.total_ms);
+      latency.insert(latency.end(), round.latency_ms.begin(),
+                     round.latency_ms.end());
+      failed += round.failed;
+      // 等服务器关闭上一轮的会话
+      std::this_thread::sleep_for(std::chrono::milliseconds(200));
+    }
+    bench::stopServer(pid);
+    printf("%-9s all replied in %8.1f ms (median)  per connection p50 %7.1f "
+           "ms  p99 %7.1f ms  failed %zu\n",
+           reuseport ? "reuseport" : "single", percentile(totals, 0.5),
+           percentile(latency, 0.5), percentile(latency, 0.99), failed);
+  }
+  return 0;
+}
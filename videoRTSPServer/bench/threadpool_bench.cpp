@@ -0,0 +1,101 @@
+// 线程池对比：原来的加锁队列实现与现在的无锁队列 + 工作窃取实现
+//   每轮由 P 个提交线程共提交 N 个空任务，统计吞吐（任务/秒）
+//   以及从提交到开始执行的延迟 p50/p99/p99.9
+//   legacy submit  原来的 ThreadPool::submit（packaged_task + std::function）
+//   new submit     现在的 ThreadPool::submit，同样返回 future
+//   new post       现在的 ThreadPool::post，不需要结果时的写法
+// 用法：threadpool_bench [每轮任务数]，两个线程池都是 6 个工作线程
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <thread>
+#include <vector>
+
+#include "legacy_threadpool.h"
+#include "threadpool.h"
+
+namespace {
+using Clock = std::chrono::steady_clock;
+
+struct Result {
+  double tasks_per_second;
+  double p50_us;
+  double p99_us;
+  double p999_us;
+};
+
+// 每个任务记下自己的排队延迟（纳秒），全部执行完再排序取分位数
+template <typename Submit>
+Result run(size_t producers, size_t tasks, Submit submit) {
+  std::vector<uint32_t> latency(tasks);
+  std::atomic<size_t> done{0};
+  std::atomic<bool> go{false};
+  std::vector<std::thread> threads;
+  for (size_t p = 0; p < producers; ++p) {
+    threads.emplace_back([&, p]() {
+      while (!go.load(std::memory_order_acquire)) {
+        std::this_thread::yield();
+      }
+      for (size_t i = p; i < tasks; i += producers) {
+        uint32_t* slot = &latency[i];
+        std::atomic<size_t>* counter = &done;
+        auto queued = Clock::now();
+        submit([slot, counter, queued]() {
+          auto waited = Clock::now() - queued;
+          *slot = static_cast<uint32_t>(std::min<int64_t>(
+              std::chrono::duration_cast<std::chrono::nanoseconds>(waited)
+                  .count(),
+              UINT32_MAX));
+          counter->fetch_add(1, std::memory_order_release);
+        });
+      }
+    });
+  }
+  auto begin = Clock::now();
+  go.store(true, std::memory_order_release);
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  while (done.load(std::memory_order_acquire) < tasks) {
+    std::this_thread::yield();
+  }
+  double seconds = std::chrono::duration<double>(Clock::now() - begin).count();
+  std::sort(latency.begin(), latency.end());
+  auto percentile = [&](double q) {
+    return latency[std::min(tasks - 1, static_cast<size_t>(tasks * q))] / 1e3;
+  };
+  return {tasks / seconds, percentile(0.50), percentile(0.99),
+          percentile(0.999)};
+}
+
+void report(const char* name, size_t producers, const Result& r) {
+  printf("%-14s %3zu producers %12.0f tasks/s  p50 %9.1f us  p99 %9.1f us  "
+         "p99.9 %9.1f us\n",
+         name, producers, r.tasks_per_second, r.p50_us, r.p99_us, r.p999_us);
+}
+}  // namespace
+
+int main(int argc, char* argv[]) {
+  size_t tasks = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 200000;
+  if (tasks == 0) {
+    fprintf(stderr, "usage: threadpool_bench [tasks per round]\n");
+    return 1;
+  }
+  legacy::ThreadPool legacy_pool(6);
+  ThreadPool* pool = ThreadPool::GetInstance().get();
+  printf("%zu tasks per round, %zu workers\n", tasks, pool->workerCount());
+  for (size_t producers : {1, 2, 4, 8, 16, 32, 64}) {
+    report("legacy submit", producers,
+           run(producers, tasks,
+               [&](auto f) { legacy_pool.submit(std::move(f)); }));
+    report("new submit", producers,
+           run(producers, tasks, [&](auto f) { pool->submit(std::move(f)); }));
+    report("new post", producers,
+           run(producers, tasks, [&](auto f) { pool->post(std::move(f)); }));
+  }
+  legacy_pool.shutdown();
+  pool->shutdown();
+  return 0;
+}
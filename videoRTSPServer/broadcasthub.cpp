@@ -0,0 +1,156 @@
+#include "broadcasthub.h"
+
+#include <algorithm>
+#include <chrono>
+#include <unordered_map>
+
+#include "asioioservicepool.h"
+#include "metrics.h"
+
+namespace {
+std::mutex g_hubs_mtx;
+std::unordered_map<std::string, std::weak_ptr<BroadcastHub>> g_hubs;
+}  // namespace
+
+std::shared_ptr<BroadcastHub> BroadcastHub::get(
+    std::shared_ptr<const MediaSource> source) {
+  const std::string& path = source->path();
+  std::lock_guard<std::mutex> lock(g_hubs_mtx);
+  auto it = g_hubs.find(path);
+  if (it != g_hubs.end()) {
+    if (auto hub = it->second.lock()) {
+      return hub;
+    }
+  }
+  auto& ioc = AsioIOServicePool::GetInstance()->GetIOService();
+  std::shared_ptr<BroadcastHub> hub(new BroadcastHub(ioc, source));
+  hub->start();
+  g_hubs[path] = hub;
+  return hub;
+}
+
+BroadcastHub::BroadcastHub(net::io_context& ioc,
+                           std::shared_ptr<const MediaSource> source)
+    : source_(source),
+      packetizer_(makePacketizer(source->codec(), kVideoPayloadType,
+                                 kVideoSSRC)),
+      pacer_(makeVideoPacer(*source, kVideoFps)),
+      batch_pool_(net::use_service<RTPBatchPool>(ioc)),
+      timer_(ioc) {}
+
+BroadcastHub::~BroadcastHub() {
+  timer_.cancel();
+  if (prefetcher_) {
+    prefetcher_->stop();
+  }
+}
+
+void BroadcastHub::subscribe(
+    const std::shared_ptr<BroadcastSubscriber>& subscriber,
+    const net::any_io_executor& executor) {
+  std::lock_guard<std::mutex> lock(mtx_);
+  subscribers_.push_back({subscriber.get(), subscriber, executor});
+}
+
+void BroadcastHub::unsubscribe(const BroadcastSubscriber* subscriber) {
+  std::lock_guard<std::mutex> lock(mtx_);
+  subscribers_.erase(
+      std::remove_if(subscribers_.begin(), subscribers_.end(),
+                     [subscriber](const Subscriber& s) {
+                       return s.raw == subscriber || s.subscriber.expired();
+                     }),
+      subscribers_.end());
+}
+
+void BroadcastHub::start() {
+  // 文件播完从头循环，模拟一路不间断的直播流；在每个 IDR 前补上 SPS/PPS，
+  // 方便中途加入的观看者解码
+  MediaCursor cursor(source_);
+  cursor.setRepeatParameterSets(true);
+  prefetcher_ = std::make_shared<FramePrefetcher>(
+      [source = source_, cursor = std::move(cursor)](
+          PrefetchedFrame& frame) mutable {
+        if (cursor.eof()) {
+          cursor = MediaCursor(source);
+          cursor.setRepeatParameterSets(true);
+        }
+        if (!cursor.readNextAccessUnit(frame.nalus)) {
+          return false;
+        }
+        frame.index = cursor.position() - 1;
+        frame.is_key = source->accessUnit(frame.index).is_key;
+        return true;
+      },
+      pacer_.frameDuration());
+  // 预读回调不持有 hub，所有观看者离开后直接丢弃
+  std::weak_ptr<BroadcastHub> weak = shared_from_this();
+  prefetcher_->start(timer_.get_executor(), [weak]() {
+    if (auto self = weak.lock()) {
+      self->scheduleNextFrame();
+    }
+  });
+  pacer_.reset(FramePacer::Clock::now());
+  scheduleNextFrame();
+}
+
+void BroadcastHub::scheduleNextFrame() {
+  // 只持有弱引用，所有观看者离开后 hub 析构，定时器随之取消
+  std::weak_ptr<BroadcastHub> weak = shared_from_this();
+  timer_.expires_at(pacer_.deadline());
+  timer_.async_wait([weak](boost::system::error_code ec) {
+    auto self = weak.lock();
+    if (ec || !self) {
+      return;
+    }
+    if (self->broadcastOne()) {
+      self->scheduleNextFrame();
+    }
+  });
+}
+
+bool BroadcastHub::broadcastOne() {
+  PrefetchedFrame* frame = prefetcher_->front();
+  if (frame == nullptr) {
+    // 预读没跟上：不在这里读盘，等帧读好后由回调重新调度；文件读不出帧时停止
+    if (prefetcher_->finished()) {
+      return false;
+    }
+    return !prefetcher_->waitReady();
+  }
+  uint32_t timestamp = advanceVideoPacer(pacer_, *source_, frame->index);
+  // 落后超过一秒（比如线程被长时间占用）就重新计时，不再补发积压的帧
+  auto now = FramePacer::Clock::now();
+  if (now - pacer_.deadline() > std::chrono::seconds(1)) {
+    pacer_.reset(now);
+  }
+  if (frame->nalus.empty()) {
+    prefetcher_->pop();
+    return true;
+  }
+
+  // 从池中取，观看者都发完后自动归还
+  auto batch = batch_pool_.acquire();
+  batch->source = source_;
+  batch->is_key = frame->is_key;
+  size_t capacity = batch->packets.capacity();
+  packetizer_->packetize(frame->nalus, timestamp, batch->packets);
+  if (batch->packets.capacity() != capacity) {
+    ++Metrics::GetInstance()->batch_buffer_grown;
+  }
+  // 包里只引用文件内存，槽位可以交还给预读
+  prefetcher_->pop();
+
+  std::lock_guard<std::mutex> lock(mtx_);
+  for (auto it = subscribers_.begin(); it != subscribers_.end();) {
+    auto subscriber = it->subscriber.lock();
+    if (!subscriber) {
+      it = subscribers_.erase(it);
+      continue;
+    }
+    net::post(it->executor, [subscriber = std::move(subscriber), batch]() {
+      subscriber->onBroadcast(batch);
+    });
+    ++it;
+  }
+  return true;
+}
@@ -0,0 +1,59 @@
+#pragma once
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "RTP.h"
+#include "global.h"
+#include "mediafile.h"
+#include "pacer.h"
+#include "prefetch.h"
+#include "rtpbatchpool.h"
+
+class BroadcastSubscriber {
+ public:
+  virtual ~BroadcastSubscriber() = default;
+  // 在订阅时给出的 executor 上调用
+  virtual void onBroadcast(const std::shared_ptr<const RTPBatch>& batch) = 0;
+};
+
+// 直播分发：每个挂载点一个 hub，每帧只读取、打包一次，再投递给所有订阅者
+// 订阅者只需改写包头里的序号、时间戳和 SSRC
+// 与普通会话一样由线程池预读帧，网络线程上不会因缺页读盘
+class BroadcastHub : public std::enable_shared_from_this<BroadcastHub> {
+ public:
+  // 第一个观看者到来时创建，所有观看者离开后自动销毁
+  // 文件由调用者事先打开（网络线程上经线程池打开），这里只查表，不碰磁盘
+  static std::shared_ptr<BroadcastHub> get(
+      std::shared_ptr<const MediaSource> source);
+  ~BroadcastHub();
+  void subscribe(const std::shared_ptr<BroadcastSubscriber>& subscriber,
+                 const net::any_io_executor& executor);
+  void unsubscribe(const BroadcastSubscriber* subscriber);
+
+ private:
+  BroadcastHub(net::io_context& ioc, std::shared_ptr<const MediaSource> source);
+  void start();
+  void scheduleNextFrame();
+  // 返回 false 表示预读还没跟上，帧读好后由回调重新调度
+  bool broadcastOne();
+
+  // 持有 mtx_ 时不能释放会话的强引用：最后一个引用在这里释放的话，
+  // 会话析构时调用 unsubscribe 会在同一把锁上死锁，所以按原始指针比较，
+  // 用 expired() 清理，投递时把强引用移进处理函数
+  struct Subscriber {
+    BroadcastSubscriber* raw;
+    std::weak_ptr<BroadcastSubscriber> subscriber;
+    net::any_io_executor executor;
+  };
+
+  std::shared_ptr<const MediaSource> source_;
+  std::shared_ptr<FramePrefetcher> prefetcher_;  // start() 时创建
+  std::unique_ptr<RTPPacketizer> packetizer_;
+  FramePacer pacer_;
+  RTPBatchPool& batch_pool_;
+  net::steady_timer timer_;
+  std::mutex mtx_;
+  std::vector<Subscriber> subscribers_;
+};
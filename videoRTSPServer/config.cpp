@@ -0,0 +1,106 @@
+#include "config.h"
+
+#include <fstream>
+#include <iostream>
+
+#include "global.h"
+
+namespace {
+bool parseBool(const std::string& value) {
+  return value == "1" || value == "true" || value == "on" || value == "yes";
+}
+// 端口号超出 0~65535 时抛异常，按格式错误处理，不截断
+uint16_t parsePort(const std::string& value) {
+  int port = std::stoi(value);
+  if (port < 0 || port > 65535) {
+    throw std::out_of_range("port");
+  }
+  return static_cast<uint16_t>(port);
+}
+}  // namespace
+
+bool ServerConfig::load(const std::string& path) {
+  std::ifstream file(path);
+  if (!file.is_open()) {
+    std::cerr << "can not open config: " << path << std::endl;
+    return false;
+  }
+  bool ok = true;
+  std::string line;
+  while (std::getline(file, line)) {
+    if (line.find_first_not_of(" \t\r") == std::string::npos) {
+      continue;
+    }
+    line = Utils::trim(line);
+    if (line[0] == '#') {
+      continue;
+    }
+    auto pos = line.find('=');
+    if (pos == std::string::npos) {
+      std::cerr << "bad config line: " << line << std::endl;
+      ok = false;
+      continue;
+    }
+    std::string key = Utils::trim(line.substr(0, pos));
+    std::string value = Utils::trim(line.substr(pos + 1));
+    try {
+      if (key == "port") {
+        port = parsePort(value);
+      } else if (key == "metrics_port") {
+        metrics_port = parsePort(value);
+      } else if (key == "media_dir") {
+        media_dir = value;
+      } else if (key == "max_open_sources") {
+        max_open_sources = std::stoul(value);
+      } else if (key == "rtp_port_min") {
+        rtp_port_min = parsePort(value);
+      } else if (key == "rtp_port_max") {
+        rtp_port_max = parsePort(value);
+      } else if (key == "media_path") {
+        media_path = value;
+      } else if (key == "broadcast") {
+        broadcast = parseBool(value);
+      } else if (key == "broadcast_shared_ssrc") {
+        broadcast_shared_ssrc = parseBool(value);
+      } else if (key == "pacing_peak_rate_mbps") {
+        pacing_peak_rate_mbps = std::stod(value);
+      } else if (key == "pacing_burst_bytes") {
+        pacing_burst_bytes = std::stoul(value);
+      } else if (key == "tcp_max_queue_bytes") {
+        tcp_max_queue_bytes = std::stoul(value);
+      } else if (key == "nack_history_packets") {
+        nack_history_packets = std::stoul(value);
+      } else if (key == "io_uring") {
+        io_uring = parseBool(value);
+      } else if (key == "io_threads") {
+        io_threads = std::stoul(value);
+      } else if (key == "io_pin_threads") {
+        io_pin_threads = parseBool(value);
+      } else if (key == "io_balance") {
+        if (value != "sessions" && value != "bitrate") {
+          std::cerr << "bad config value: " << line << std::endl;
+          ok = false;
+          continue;
+        }
+        io_balance = value;
+      } else if (key == "reuseport_acceptors") {
+        reuseport_acceptors = parseBool(value);
+      } else {
+        std::cerr << "unknown config key: " << key << std::endl;
+      }
+    } catch (std::exception& exp) {
+      std::cerr << "bad config value: " << line << std::endl;
+      ok = false;
+    }
+  }
+  // RTP 端口要成对分配（偶数 RTP + 奇数 RTCP），范围内至少放得下一对
+  uint32_t first_rtp_port = (uint32_t(rtp_port_min) + 1) & ~1u;
+  if (first_rtp_port + 1 > rtp_port_max) {
+    std::cerr << "bad rtp port range: " << rtp_port_min << "-" << rtp_port_max
+              << ", use default" << std::endl;
+    rtp_port_min = ServerConfig().rtp_port_min;
+    rtp_port_max = ServerConfig().rtp_port_max;
+    ok = false;
+  }
+  return ok;
+}
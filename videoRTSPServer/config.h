@@ -0,0 +1,56 @@
+#pragma once
+#include <cstdint>
+#include <string>
+
+#include "singleton.h"
+
+// 服务器配置，启动时从 key = value 格式的文件加载，未配置的项使用默认值
+class ServerConfig : public Singleton<ServerConfig> {
+  friend class Singleton<ServerConfig>;
+
+ public:
+  // 读取配置文件，文件不存在或某行格式不对时返回 false，已读到的配置仍然生效
+  bool load(const std::string& path);
+
+  uint16_t port = 8554;
+  // Prometheus 指标的 HTTP 端口，0 表示不开启
+  uint16_t metrics_port = 0;
+  // 挂载为 rtsp://host:port/live 的文件，兼容只有一路流的用法
+  std::string media_path =
+      "/home/ranx/work/edoyun/videoRTSPServer/data/"
+      "TheaterSquare_3840x2160.h264";
+  // 媒体目录，启动时扫描，其中的文件按相对路径挂载，空表示不扫描
+  std::string media_dir;
+  // 同时保持打开的媒体源个数，超过后按 LRU 释放
+  size_t max_open_sources = 64;
+  // 服务器端 RTP/RTCP 端口范围 [min, max]，每个 UDP 会话占用一对
+  uint16_t rtp_port_min = 55000;
+  uint16_t rtp_port_max = 55999;
+  // 直播模式：同一路流只读取、打包一次，分发给所有观看者
+  bool broadcast = false;
+  // 直播模式下所有观看者共用一个 SSRC，此时包头也不用逐个改写
+  bool broadcast_shared_ssrc = false;
+  // 平滑发送的峰值速率（Mbit/s），0 表示不做平滑，整帧立即发出
+  double pacing_peak_rate_mbps = 0;
+  // 令牌桶容量，即允许的最大瞬时突发字节数
+  size_t pacing_burst_bytes = 64 * 1024;
+  // TCP 交错传输时每个连接最多积压的字节数，超过后丢帧直到下一个关键帧
+  size_t tcp_max_queue_bytes = 4 * 1024 * 1024;
+  // 每个 UDP 会话保留的最近 RTP 包个数，用于响应 NACK 重传，0 表示关闭
+  size_t nack_history_packets = 4096;
+  // 整帧的 RTP 发送走 io_uring，编译时开启 ENABLE_IO_URING 才有效，
+  // 内核不支持时自动退回 sendmmsg
+  bool io_uring = true;
+  // 网络线程数（每个线程一个 io_context），0 表示按进程可用的 CPU 个数
+  size_t io_threads = 0;
+  // 网络线程各绑定一个核，多个 NUMA 节点时轮流分布到各节点
+  bool io_pin_threads = true;
+  // 新会话放到哪个网络线程：sessions 按会话数，bitrate 按最近的发送速率
+  std::string io_balance = "sessions";
+  // 每个网络线程各开一个 SO_REUSEPORT 监听，由内核分配新连接，
+  // 大量客户端同时重连时接受连接不再集中在一个线程；此时 io_balance 不起作用
+  bool reuseport_acceptors = false;
+
+ private:
+  ServerConfig() = default;
+};
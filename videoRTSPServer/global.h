@@ -1,5 +1,6 @@
 #pragma once
 #include <boost/asio.hpp>
+#include <cstdint>
 #include <iomanip>
 #include <random>
 #include <sstream>
@@ -17,7 +18,8 @@ enum class RTSPMethod {
   TEARDOWN,
   PAUSE,
   GET_PARAMETER,
-  SET_PARAMETER
+  SET_PARAMETER,
+  ANNOUNCE
 };
 
 enum class StatusCode {
@@ -39,6 +41,11 @@ enum class MediaType { VIDEO, AUDIO, NONE };
 
 enum class CodecId { H264 = 96, H265 = 265, AAC = 97, PCMA = 8, PCMU = 0 };
 
+// 视频的 RTP 参数，会话、直播 hub 和 SDP 共用，直播共用 SSRC 时 hub 的值直接上线
+constexpr uint8_t kVideoPayloadType = 96;    // 动态负载类型
+constexpr uint32_t kVideoSSRC = 0x12345678;  // 音频为 +1
+constexpr int kVideoFps = 60;  // 裸码流没有时间戳，按这个帧率发送
+
 class Utils {
  public:
   static RTSPMethod Str2Method(std::string_view methodStr) {
@@ -50,7 +57,8 @@ class Utils {
         {"PAUSE", RTSPMethod::PAUSE},
         {"TEARDOWN", RTSPMethod::TEARDOWN},
         {"GET_PARAMETER", RTSPMethod::GET_PARAMETER},
-        {"SET_PARAMETER", RTSPMethod::SET_PARAMETER}};
+        {"SET_PARAMETER", RTSPMethod::SET_PARAMETER},
+        {"ANNOUNCE", RTSPMethod::ANNOUNCE}};
 
     auto it = methodMap.find(methodStr);
     if (it != methodMap.end()) {
@@ -77,6 +85,8 @@ class Utils {
         return "GET_PARAMETER";
       case RTSPMethod::SET_PARAMETER:
         return "SET_PARAMETER";
+      case RTSPMethod::ANNOUNCE:
+        return "ANNOUNCE";
       default:
         return "UNKNOWN";
     }
@@ -100,14 +110,38 @@ class Utils {
     size_t last = str.find_last_not_of(" \t\r\n");
     return str.substr(first, (last - first + 1));
   }
+  static std::string_view trim(std::string_view str) {
+    size_t first = str.find_first_not_of(" \t\r\n");
+    if (std::string_view::npos == first) return {};
+    size_t last = str.find_last_not_of(" \t\r\n");
+    return str.substr(first, (last - first + 1));
+  }
+  // ASCII 范围内不区分大小写比较，用于 RTSP 头部名称
+  static bool iequals(std::string_view a, std::string_view b) {
+    if (a.size() != b.size()) return false;
+    for (size_t i = 0; i < a.size(); ++i) {
+      char x = a[i] >= 'A' && a[i] <= 'Z' ? a[i] + 32 : a[i];
+      char y = b[i] >= 'A' && b[i] <= 'Z' ? b[i] + 32 : b[i];
+      if (x != y) return false;
+    }
+    return true;
+  }
   static std::string_view Code2Str(StatusCode code) {
     switch (code) {
       case StatusCode::OK:
         return "OK";
       case StatusCode::BAD_REQUEST:
         return "Bad Request";
+      case StatusCode::UNAUTHORIZED:
+        return "Unauthorized";
       case StatusCode::NOT_FOUND:
         return "Not Found";
+      case StatusCode::METHOD_NOT_ALLOWED:
+        return "Method Not Allowed";
+      case StatusCode::SESSION_NOT_FOUND:
+        return "Session Not Found";
+      case StatusCode::UNSUPPORTED_TRANSPORT:
+        return "Unsupported Transport";
       case StatusCode::INTERNAL_SERVER_ERROR:
         return "Internal Server Error";
       default:
@@ -0,0 +1,113 @@
+#include "mediacatalog.h"
+
+#include <filesystem>
+#include <iostream>
+
+#include "mp4demux.h"
+#include "sdp.h"
+
+namespace fs = std::filesystem;
+
+size_t MediaCatalog::scan(const std::string& dir) {
+  std::error_code ec;
+  fs::recursive_directory_iterator it(dir, ec), end;
+  if (ec) {
+    std::cerr << "can not scan media dir " << dir << ": " << ec.message()
+              << std::endl;
+    return 0;
+  }
+  size_t count = 0;
+  for (; it != end; it.increment(ec)) {
+    if (ec) {
+      break;
+    }
+    if (!it->is_regular_file(ec)) {
+      continue;
+    }
+    const fs::path& path = it->path();
+    std::string ext = path.extension().string();
+    if (ext != ".h264" && ext != ".264" && ext != ".h265" && ext != ".265" &&
+        ext != ".hevc" && !isMp4Path(ext)) {
+      continue;
+    }
+    fs::path relative = path.lexically_relative(dir);
+    add(relative.generic_string(), path.string());
+    add(relative.replace_extension().generic_string(), path.string());
+    ++count;
+  }
+  std::cout << "media catalog: " << count << " files in " << dir << std::endl;
+  return count;
+}
+
+void MediaCatalog::add(const std::string& mount, const std::string& path) {
+  mounts_[mount] = path;
+}
+
+const std::string* MediaCatalog::find(std::string_view mount) const {
+  auto it = mounts_.find(std::string(mount));
+  return it == mounts_.end() ? nullptr : &it->second;
+}
+
+const std::string* MediaCatalog::resolve(std::string_view url) const {
+  // rtsp://host:port/a/b?x=1 -> a/b
+  size_t scheme = url.find("://");
+  if (scheme != std::string_view::npos) {
+    url.remove_prefix(scheme + 3);
+    size_t slash = url.find('/');
+    url.remove_prefix(slash == std::string_view::npos ? url.size() : slash);
+  }
+  url = url.substr(0, url.find('?'));
+  while (!url.empty() && url.front() == '/') {
+    url.remove_prefix(1);
+  }
+  while (!url.empty() && url.back() == '/') {
+    url.remove_suffix(1);
+  }
+  if (const std::string* path = find(url)) {
+    return path;
+  }
+  // 去掉最后一级，即 SDP 里 a=control 指定的轨道
+  size_t slash = url.rfind('/');
+  if (slash == std::string_view::npos) {
+    return nullptr;
+  }
+  return find(url.substr(0, slash));
+}
+
+std::shared_ptr<const MediaSource> MediaCatalog::cached(
+    const std::string& path) {
+  std::lock_guard<std::mutex> lock(mtx_);
+  auto it = open_.find(path);
+  if (it == open_.end()) {
+    return nullptr;
+  }
+  lru_.splice(lru_.begin(), lru_, it->second);
+  return it->second->second;
+}
+
+std::shared_ptr<const MediaSource> MediaCatalog::open(const std::string& path) {
+  if (auto source = cached(path)) {
+    return source;
+  }
+  // 映射、建索引可能很慢，不持有锁，其它文件的查找不受影响；
+  // 同一文件并发打开时 MediaSource::open 保证只建一次索引
+  auto source = MediaSource::open(path);
+  if (!source) {
+    return nullptr;
+  }
+  std::lock_guard<std::mutex> lock(mtx_);
+  auto it = open_.find(path);
+  if (it != open_.end()) {
+    lru_.splice(lru_.begin(), lru_, it->second);
+    return it->second->second;
+  }
+  lru_.emplace_front(path, source);
+  open_[path] = lru_.begin();
+  while (lru_.size() > max_open_) {
+    // SDP 缓存随之清掉，下次打开时重新生成
+    SDPCache::GetInstance()->erase(lru_.back().first);
+    open_.erase(lru_.back().first);
+    lru_.pop_back();
+  }
+  return source;
+}
@@ -0,0 +1,46 @@
+#pragma once
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+#include "mediafile.h"
+#include "singleton.h"
+
+// 媒体目录：把 RTSP URL 的路径映射到媒体文件，启动时扫描配置的目录建立
+// 媒体源在第一次 DESCRIBE/PLAY 时才打开，只保留最近用过的若干个，
+// 超过上限时按 LRU 释放最久未用的（仍在播放的会话自己持有，不受影响）
+class MediaCatalog : public Singleton<MediaCatalog> {
+  friend class Singleton<MediaCatalog>;
+
+ public:
+  // 递归扫描 dir 下的 H.264（.h264/.264）、H.265（.h265/.265/.hevc）和 MP4（.mp4/.m4v/.mov）文件，
+  // 挂载名为相对路径，带不带扩展名都能访问
+  // 返回找到的文件数；挂载表只在启动时修改，之后查找不加锁
+  size_t scan(const std::string& dir);
+  void add(const std::string& mount, const std::string& path);
+  // 由请求 URL 找到文件路径，SETUP 的 URL 末尾带轨道控制路径（如 /track0）也能找到
+  // 找不到返回 nullptr
+  const std::string* resolve(std::string_view url) const;
+  // 打开（或从缓存中取）文件，失败返回 nullptr
+  // 第一次打开要映射文件、建索引，可能读很久的盘，网络线程应放到线程池中调用
+  std::shared_ptr<const MediaSource> open(const std::string& path);
+  // 只从缓存中取，不会阻塞在磁盘上，没有打开过返回 nullptr
+  std::shared_ptr<const MediaSource> cached(const std::string& path);
+  void setMaxOpen(size_t max_open) { max_open_ = max_open; }
+
+ private:
+  MediaCatalog() = default;
+  const std::string* find(std::string_view mount) const;
+
+  std::unordered_map<std::string, std::string> mounts_;  // 挂载名 -> 文件路径
+
+  using LRUList =
+      std::list<std::pair<std::string, std::shared_ptr<const MediaSource>>>;
+  std::mutex mtx_;
+  size_t max_open_ = 64;
+  LRUList lru_;  // 头部为最近使用
+  std::unordered_map<std::string, LRUList::iterator> open_;
+};
@@ -1,88 +1,621 @@
 #include "mediafile.h"
-Nalu Nalu::readNextNalu(std::ifstream& video_file) {
-  Nalu nalu;
 
-  // 1. 检查文件状态
-  if (!video_file.is_open() || video_file.eof()) {
-    return nalu;
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <future>
+#include <iostream>
+#include <mutex>
+#include <type_traits>
+#include <unordered_map>
+
+#include "mp4demux.h"
+
+const uint8_t* findStartCode(const uint8_t* begin, const uint8_t* end) {
+  if (end - begin < 3) {
+    return end;
   }
+  // 起始码的 01 至少在 begin + 2 的位置
+  const uint8_t* p = begin + 2;
+  while (p < end) {
+    p = static_cast<const uint8_t*>(memchr(p, 0x01, end - p));
+    if (p == nullptr) {
+      return end;
+    }
+    if (p[-1] == 0 && p[-2] == 0) {
+      return p - 2;
+    }
+    // 当前的 01 不是起始码，下一个可能的 01 至少在 3 字节之后
+    p += 3;
+  }
+  return end;
+}
 
-  // 2. 跳过当前的起始码 (Start Code)
-  // H.264 起始码可能是 00 00 01 (3字节) 或 00 00 00 01 (4字节)
-  uint8_t buf[4] = {0};
-  video_file.read((char*)buf, 3);  // 先读 3 个字节
-  size_t read_count = video_file.gcount();
+namespace {
+// 已打开的媒体文件，弱引用：没有会话使用时自动释放映射
+// 正在打开的文件记下 loading，同一路径的其它调用者等待它，而不是再打开一次；
+// 锁只保护这张表，映射、建索引时不持有
+struct SourceEntry {
+  std::weak_ptr<const MediaSource> source;
+  std::shared_future<std::shared_ptr<const MediaSource>> loading;
+};
+std::mutex g_sources_mtx;
+std::unordered_map<std::string, SourceEntry> g_sources;
 
-  if (read_count < 3) return nalu;  // 文件太短
+// 各编码 NALU 头的解释
+uint8_t naluType(CodecId codec, const uint8_t* payload) {
+  return codec == CodecId::H265 ? (payload[0] >> 1) & 0x3F : payload[0] & 0x1F;
+}
+bool isVcl(CodecId codec, uint8_t type) {
+  return codec == CodecId::H265 ? type <= 31 : type >= 1 && type <= 5;
+}
+// H.264 的 IDR；H.265 的 IRAP（BLA/IDR/CRA，16~23）
+bool isKey(CodecId codec, uint8_t type) {
+  return codec == CodecId::H265 ? type >= 16 && type <= 23 : type == 5;
+}
+bool isParameterSet(CodecId codec, uint8_t type) {
+  return codec == CodecId::H265 ? type >= 32 && type <= 34
+                                : type == 7 || type == 8;
+}
+// 一帧的第一个 slice：H.264 first_mb_in_slice == 0（ue(v) 第一位为 1），
+// H.265 first_slice_segment_in_pic_flag，紧跟在 NALU 头之后
+bool isFirstSlice(CodecId codec, const uint8_t* payload, size_t size) {
+  size_t header = codec == CodecId::H265 ? 2 : 1;
+  return size > header && (payload[header] & 0x80);
+}
+// 上一帧已有 VCL 后，遇到这些非 VCL NALU 即为新的一帧
+// H.264 7.4.1.2.3：AUD/SPS/PPS/SEI/14~18；H.265 7.4.2.4.4：VPS/SPS/PPS/AUD/前缀 SEI/41~44/48~55
+bool startsUnit(CodecId codec, uint8_t type) {
+  if (codec == CodecId::H265) {
+    return (type >= 32 && type <= 35) || type == 39 ||
+           (type >= 41 && type <= 44) || (type >= 48 && type <= 55);
+  }
+  return (type >= 6 && type <= 9) || (type >= 14 && type <= 18);
+}
+
+// 索引文件头，之后依次是 NaluInfo[nalu_count]、AccessUnitInfo[unit_count]、
+// uint32_t[key_count]（关键帧序号）、uint32_t[param_count]（参数集序号）
+struct IndexFileHeader {
+  char magic[4];
+  uint32_t version;
+  uint32_t codec;  // 建索引时按哪种编码解释 NALU 类型
+  uint32_t reserved;
+  uint64_t media_size;  // 媒体文件大小和修改时间，用于判断索引是否过期
+  int64_t media_mtime_ns;
+  uint64_t nalu_count;
+  uint64_t unit_count;
+  uint64_t key_count;
+  uint64_t param_count;
+};
+constexpr char kIndexMagic[4] = {'N', 'I', 'D', 'X'};
+constexpr uint32_t kIndexVersion = 2;
+
+static_assert(sizeof(IndexFileHeader) % 8 == 0, "header must keep alignment");
+static_assert(sizeof(NaluInfo) == 16, "NaluInfo is an on-disk record");
+static_assert(sizeof(AccessUnitInfo) == 12,
+              "AccessUnitInfo is an on-disk record");
+static_assert(std::is_trivially_copyable<NaluInfo>::value &&
+                  std::is_trivially_copyable<AccessUnitInfo>::value,
+              "index records are written with memcpy");
+}  // namespace
+
+ParameterSetTypes parameterSetTypes(CodecId codec) {
+  if (codec == CodecId::H265) {
+    return {{32, 33, 34}, 3};
+  }
+  return {{7, 8, 0}, 2};
+}
+
+CodecId codecFromPath(const std::string& path) {
+  size_t dot = path.rfind('.');
+  std::string_view ext =
+      dot == std::string::npos ? std::string_view() : std::string_view(path).substr(dot);
+  if (Utils::iequals(ext, ".h265") || Utils::iequals(ext, ".265") ||
+      Utils::iequals(ext, ".hevc")) {
+    return CodecId::H265;
+  }
+  return CodecId::H264;
+}
 
-  // 判断是否是 00 00 01
-  if (buf[0] == 0 && buf[1] == 0 && buf[2] == 1) {
-    // 这是一个 3 字节起始码，已经跳过完成了
+std::shared_ptr<const MediaSource> MediaSource::open(const std::string& path) {
+  std::promise<std::shared_ptr<const MediaSource>> promise;
+  {
+    std::unique_lock<std::mutex> lock(g_sources_mtx);
+    SourceEntry& entry = g_sources[path];
+    if (auto source = entry.source.lock()) {
+      return source;
+    }
+    if (entry.loading.valid()) {
+      auto loading = entry.loading;
+      lock.unlock();
+      return loading.get();
+    }
+    entry.loading = promise.get_future().share();
   }
-  // 判断是否是 00 00 00 ...
-  else if (buf[0] == 0 && buf[1] == 0 && buf[2] == 0) {
-    // 读第 4 个字节看是不是 1
-    video_file.read((char*)&buf[3], 1);
-    if (video_file.gcount() == 1 && buf[3] == 1) {
-      // 这是一个 4 字节起始码 (00 00 00 01)，跳过完成
+  // 建索引可能抛出 bad_alloc 等异常，当作打开失败：清掉 loading，等待者拿到
+  // nullptr，后面还能重试；在线程池中调用时异常也不会终止服务器
+  std::shared_ptr<const MediaSource> source;
+  try {
+    source = load(path);
+  } catch (std::exception& e) {
+    std::cerr << "open " << path << " failed: " << e.what() << std::endl;
+  }
+  {
+    std::lock_guard<std::mutex> lock(g_sources_mtx);
+    if (source) {
+      g_sources[path] = {source, {}};
     } else {
-      // 不是标准起始码，可能文件损坏或指针错位
-      // 简单处理：回退，尝试作为普通数据读取（或者报错）
-      // 这里选择容错：回退读取的字节，让后续逻辑去处理
-      video_file.seekg(-(int)video_file.gcount(), std::ios::cur);
+      g_sources.erase(path);
+    }
+  }
+  promise.set_value(source);
+  return source;
+}
+
+std::shared_ptr<const MediaSource> MediaSource::load(const std::string& path) {
+  std::shared_ptr<MediaSource> source(new MediaSource(path));
+  if (!source->mapFile()) {
+    return nullptr;
+  }
+  if (isMp4Path(path)) {
+    // MP4 的样本表本身就是索引，音频取自同一个文件
+    if (!source->loadMp4()) {
+      return nullptr;
     }
   } else {
-    // 不是起始码，说明可能是在文件中间。回退指针，准备当做数据读。
-    video_file.seekg(-3, std::ios::cur);
-  }
-
-  // 3. 逐字节读取数据，直到遇到下一个起始码或 EOF
-  // 这种方法效率不是极致，但逻辑最清晰。优化可用 buffer 批量读。
-  char byte;
-  int zero_count = 0;  // 连续 0 的个数
-
-  while (video_file.get(byte)) {
-    nalu.data.push_back(static_cast<uint8_t>(byte));
-
-    if (byte == 0x00) {
-      zero_count++;
-    } else if (byte == 0x01) {
-      // 遇到 01，检查前面有几个 0
-      if (zero_count >= 2) {
-        // --- 发现下一个起始码！ ---
-        // 现在的 nalu.data 尾部包含了 00 00 01 或 00 00 00 01
-        // 我们需要把这些“下一个 NALU 的开头”从当前数据里删掉
-        // 并把文件指针回退，留给下一次 readNextNalu 读取
-
-        // 计算回退步数：
-        // 如果是 00 00 01，回退 3 字节
-        // 如果是 00 00 00 01，回退 4 字节
-        // zero_count 是遇到 01 之前的 0 的个数
-
-        int start_code_len = (zero_count >= 3) ? 4 : 3;
-
-        // 从数据末尾移除起始码
-        for (int i = 0; i < start_code_len; i++) {
-          nalu.data.pop_back();
-        }
-
-        // 文件指针回退
-        video_file.seekg(-start_code_len, std::ios::cur);
-
-        // 标记读取成功
-        nalu.is_valid = true;
-        return nalu;
+    // 优先使用索引文件，过期或不存在时重新扫描并写回
+    if (!source->loadIndex()) {
+      source->buildIndex();
+      source->saveIndex();
+    }
+    source->audio_ = AudioSource::openCompanion(path);
+  }
+  return source;
+}
+
+MediaSource::MediaSource(const std::string& path)
+    : path_(path), codec_(codecFromPath(path)) {}
+
+MediaSource::~MediaSource() {
+  if (data_ != nullptr) {
+    munmap(const_cast<uint8_t*>(data_), size_);
+  }
+  if (index_map_ != nullptr) {
+    munmap(const_cast<uint8_t*>(index_map_), index_map_size_);
+  }
+}
+
+bool MediaSource::mapFile() {
+  int fd = ::open(path_.c_str(), O_RDONLY);
+  if (fd < 0) {
+    std::cerr << "open media failed: " << path_ << std::endl;
+    return false;
+  }
+  struct stat st;
+  if (fstat(fd, &st) != 0 || st.st_size == 0) {
+    ::close(fd);
+    return false;
+  }
+  void* addr = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  // 映射建立后 fd 就不需要了
+  ::close(fd);
+  if (addr == MAP_FAILED) {
+    std::cerr << "mmap media failed: " << path_ << std::endl;
+    return false;
+  }
+  data_ = static_cast<const uint8_t*>(addr);
+  size_ = st.st_size;
+  mtime_ns_ = int64_t(st.st_mtim.tv_sec) * 1000000000 + st.st_mtim.tv_nsec;
+  return true;
+}
+
+bool MediaSource::loadIndex() {
+  int fd = ::open(indexPath().c_str(), O_RDONLY);
+  if (fd < 0) {
+    return false;
+  }
+  struct stat st;
+  if (fstat(fd, &st) != 0 ||
+      size_t(st.st_size) < sizeof(IndexFileHeader)) {
+    ::close(fd);
+    return false;
+  }
+  void* addr = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  ::close(fd);
+  if (addr == MAP_FAILED) {
+    return false;
+  }
+  // 索引文件可能被截断或改动过，每条记录都检查后才使用，否则重新扫描
+  if (!attachIndex(static_cast<const uint8_t*>(addr), st.st_size) ||
+      !validIndex()) {
+    std::cerr << "index out of date or corrupt: " << indexPath() << std::endl;
+    munmap(addr, st.st_size);
+    return false;
+  }
+  index_map_ = static_cast<const uint8_t*>(addr);
+  index_map_size_ = st.st_size;
+  return true;
+}
+
+bool MediaSource::attachIndex(const uint8_t* data, size_t size) {
+  IndexFileHeader header;
+  memcpy(&header, data, sizeof(header));
+  if (memcmp(header.magic, kIndexMagic, 4) != 0 ||
+      header.version != kIndexVersion ||
+      header.codec != static_cast<uint32_t>(codec_) ||
+      header.media_size != size_ ||
+      header.media_mtime_ns != mtime_ns_) {
+    return false;
+  }
+  // 先逐个检查个数，避免下面的乘法溢出
+  size_t remain = size - sizeof(IndexFileHeader);
+  if (header.nalu_count > remain / sizeof(NaluInfo)) {
+    return false;
+  }
+  remain -= header.nalu_count * sizeof(NaluInfo);
+  if (header.unit_count > remain / sizeof(AccessUnitInfo)) {
+    return false;
+  }
+  remain -= header.unit_count * sizeof(AccessUnitInfo);
+  if (header.key_count > remain / sizeof(uint32_t) ||
+      header.param_count > remain / sizeof(uint32_t) - header.key_count ||
+      (header.key_count + header.param_count) * sizeof(uint32_t) != remain) {
+    return false;
+  }
+  const uint8_t* p = data + sizeof(IndexFileHeader);
+  nalus_ = reinterpret_cast<const NaluInfo*>(p);
+  nalu_count_ = header.nalu_count;
+  p += nalu_count_ * sizeof(NaluInfo);
+  units_ = reinterpret_cast<const AccessUnitInfo*>(p);
+  unit_count_ = header.unit_count;
+  p += unit_count_ * sizeof(AccessUnitInfo);
+  key_units_ = reinterpret_cast<const uint32_t*>(p);
+  key_count_ = header.key_count;
+  p += key_count_ * sizeof(uint32_t);
+  param_nalus_ = reinterpret_cast<const uint32_t*>(p);
+  param_count_ = header.param_count;
+  return true;
+}
+
+bool MediaSource::validIndex() const {
+  // 每条记录都要落在媒体文件、各表的范围内，否则读取时会越界
+  for (size_t i = 0; i < nalu_count_; ++i) {
+    const NaluInfo& nalu = nalus_[i];
+    if (nalu.size == 0 || nalu.offset > size_ ||
+        nalu.size > size_ - nalu.offset) {
+      return false;
+    }
+  }
+  for (size_t i = 0; i < unit_count_; ++i) {
+    const AccessUnitInfo& unit = units_[i];
+    if (unit.nalu_count == 0 ||
+        uint64_t(unit.first_nalu) + unit.nalu_count > nalu_count_) {
+      return false;
+    }
+  }
+  // 两张序号表要严格递增，查找时用的是二分
+  for (size_t i = 0; i < key_count_; ++i) {
+    if (key_units_[i] >= unit_count_ ||
+        (i > 0 && key_units_[i] <= key_units_[i - 1])) {
+      return false;
+    }
+  }
+  for (size_t i = 0; i < param_count_; ++i) {
+    if (param_nalus_[i] >= nalu_count_ ||
+        (i > 0 && param_nalus_[i] <= param_nalus_[i - 1])) {
+      return false;
+    }
+  }
+  return true;
+}
+
+void MediaSource::buildIndex() {
+  std::vector<NaluInfo> nalus;
+  std::vector<AccessUnitInfo> units;
+  std::vector<uint32_t> key_units;
+  std::vector<uint32_t> param_nalus;
+
+  const uint8_t* end = data_ + size_;
+  const uint8_t* sc = findStartCode(data_, end);
+  bool unit_has_vcl = false;
+  while (sc != end) {
+    const uint8_t* payload = sc + 3;
+    const uint8_t* next = findStartCode(payload, end);
+    const uint8_t* nalu_end = next;
+    while (nalu_end > payload && nalu_end[-1] == 0) {
+      --nalu_end;
+    }
+    sc = next;
+    if (nalu_end == payload) {
+      continue;
+    }
+
+    NaluInfo info;
+    info.offset = payload - data_;
+    info.size = static_cast<uint32_t>(nalu_end - payload);
+    info.type = naluType(codec_, payload);
+
+    // 访问单元边界：上一帧已有 VCL 后，遇到特定的非 VCL NALU，
+    // 或一帧的第一个 slice，即为新的一帧
+    bool vcl = isVcl(codec_, info.type);
+    bool first_slice = vcl && isFirstSlice(codec_, payload, info.size);
+    bool starts_unit = startsUnit(codec_, info.type) || first_slice;
+    if (units.empty() || (unit_has_vcl && starts_unit)) {
+      AccessUnitInfo unit;
+      unit.first_nalu = static_cast<uint32_t>(nalus.size());
+      units.push_back(unit);
+      unit_has_vcl = false;
+    }
+    AccessUnitInfo& unit = units.back();
+    ++unit.nalu_count;
+    if (isKey(codec_, info.type) && !unit.is_key) {
+      unit.is_key = 1;
+      key_units.push_back(static_cast<uint32_t>(units.size() - 1));
+    }
+    if (isParameterSet(codec_, info.type)) {
+      param_nalus.push_back(static_cast<uint32_t>(nalus.size()));
+    }
+    if (vcl) {
+      unit_has_vcl = true;
+    }
+    nalus.push_back(info);
+  }
+
+  packIndex(nalus, units, key_units, param_nalus);
+}
+
+void MediaSource::packIndex(const std::vector<NaluInfo>& nalus,
+                            const std::vector<AccessUnitInfo>& units,
+                            const std::vector<uint32_t>& key_units,
+                            const std::vector<uint32_t>& param_nalus) {
+  // 按索引文件的格式存放，保存时直接写出
+  IndexFileHeader header;
+  memcpy(header.magic, kIndexMagic, 4);
+  header.version = kIndexVersion;
+  header.codec = static_cast<uint32_t>(codec_);
+  header.reserved = 0;
+  header.media_size = size_;
+  header.media_mtime_ns = mtime_ns_;
+  header.nalu_count = nalus.size();
+  header.unit_count = units.size();
+  header.key_count = key_units.size();
+  header.param_count = param_nalus.size();
+
+  index_buffer_.resize(sizeof(header) + nalus.size() * sizeof(NaluInfo) +
+                       units.size() * sizeof(AccessUnitInfo) +
+                       (key_units.size() + param_nalus.size()) *
+                           sizeof(uint32_t));
+  uint8_t* p = index_buffer_.data();
+  auto append = [&p](const void* src, size_t len) {
+    if (len > 0) {
+      memcpy(p, src, len);
+      p += len;
+    }
+  };
+  append(&header, sizeof(header));
+  append(nalus.data(), nalus.size() * sizeof(NaluInfo));
+  append(units.data(), units.size() * sizeof(AccessUnitInfo));
+  append(key_units.data(), key_units.size() * sizeof(uint32_t));
+  append(param_nalus.data(), param_nalus.size() * sizeof(uint32_t));
+  attachIndex(index_buffer_.data(), index_buffer_.size());
+}
+
+bool MediaSource::loadMp4() {
+  std::vector<Mp4Track> tracks;
+  if (!parseMp4(data_, size_, tracks)) {
+    std::cerr << "can not parse mp4: " << path_ << std::endl;
+    return false;
+  }
+  const Mp4Track* video = nullptr;
+  const Mp4Track* audio = nullptr;
+  for (const Mp4Track& track : tracks) {
+    if (track.type == MediaType::VIDEO && !video) {
+      video = &track;
+    } else if (track.type == MediaType::AUDIO && !audio) {
+      audio = &track;
+    }
+  }
+  if (!video || video->samples.empty()) {
+    std::cerr << "no video track in " << path_ << std::endl;
+    return false;
+  }
+  codec_ = video->codec;
+  nal_length_size_ = video->nal_length_size;
+
+  std::vector<NaluInfo> nalus;
+  std::vector<AccessUnitInfo> units;
+  std::vector<uint32_t> key_units;
+  std::vector<uint32_t> param_nalus;
+  // 参数集放在最前面，paramNaluBefore 对任何帧都能找到
+  for (const Mp4Range& range : video->parameter_sets) {
+    NaluInfo info;
+    info.offset = range.offset;
+    info.size = range.size;
+    info.type = naluType(codec_, data_ + range.offset);
+    if (isParameterSet(codec_, info.type)) {
+      param_nalus.push_back(static_cast<uint32_t>(nalus.size()));
+      nalus.push_back(info);
+    }
+  }
+  // 一个样本一帧，时间统一换算到 90kHz，时长取相邻 dts 之差，换算误差不会累积
+  uint64_t timescale = video->timescale;
+  // 先除后乘，tfdt 很大时也不会溢出
+  auto to90k = [timescale](int64_t t) {
+    int64_t scale = static_cast<int64_t>(timescale);
+    return t / scale * 90000 + t % scale * 90000 / scale;
+  };
+  timing_.reserve(video->samples.size());
+  for (size_t i = 0; i < video->samples.size(); ++i) {
+    const Mp4Sample& sample = video->samples[i];
+    NaluInfo info;
+    info.offset = sample.offset;
+    info.size = sample.size;
+    AccessUnitInfo unit;
+    unit.first_nalu = static_cast<uint32_t>(nalus.size());
+    unit.nalu_count = 1;
+    unit.is_key = sample.sync;
+    if (sample.sync) {
+      key_units.push_back(static_cast<uint32_t>(units.size()));
+    }
+    nalus.push_back(info);
+    units.push_back(unit);
+
+    UnitTiming timing;
+    timing.dts = to90k(sample.dts);
+    timing.cts = static_cast<int32_t>(to90k(sample.cts));
+    if (i > 0) {
+      // tfdt 倒退时不让时间回退（否则时长按无符号数会变成十几个小时，
+      // 按时间查找帧的二分也会出错），这一帧与上一帧同时发送
+      UnitTiming& prev = timing_[i - 1];
+      timing.dts = std::max(timing.dts, prev.dts);
+      prev.duration = static_cast<uint32_t>(
+          std::min<int64_t>(timing.dts - prev.dts, UINT32_MAX));
+    }
+    timing_.push_back(timing);
+  }
+  // 最后一帧的时长与前一帧相同
+  if (timing_.size() >= 2) {
+    timing_.back().duration = timing_[timing_.size() - 2].duration;
+  } else {
+    timing_.back().duration = 3000;
+  }
+  packIndex(nalus, units, key_units, param_nalus);
+  if (audio) {
+    audio_ = AudioSource::openMp4Track(path_, *audio);
+  }
+  return true;
+}
+
+void MediaSource::saveIndex() const {
+  // 先写临时文件再改名，避免其他进程读到写了一半的索引
+  std::string tmp_path = indexPath() + ".tmp";
+  std::ofstream out(tmp_path, std::ios::binary | std::ios::trunc);
+  if (!out.is_open()) {
+    std::cerr << "can not write index: " << tmp_path << std::endl;
+    return;
+  }
+  out.write(reinterpret_cast<const char*>(index_buffer_.data()),
+            index_buffer_.size());
+  out.close();
+  if (!out || rename(tmp_path.c_str(), indexPath().c_str()) != 0) {
+    std::cerr << "can not write index: " << indexPath() << std::endl;
+    unlink(tmp_path.c_str());
+  }
+}
+
+size_t MediaSource::keyUnitAtOrBefore(size_t unit) const {
+  const uint32_t* end = key_units_ + key_count_;
+  const uint32_t* it = std::upper_bound(key_units_, end, unit);
+  return it == key_units_ ? 0 : *(it - 1);
+}
+
+double MediaSource::unitTime(size_t unit, int fps) const {
+  if (timing_.empty()) {
+    return static_cast<double>(unit) / fps;
+  }
+  int64_t start = timing_.front().dts;
+  if (unit >= timing_.size()) {
+    const UnitTiming& last = timing_.back();
+    return (last.dts + last.duration - start) / 90000.0;
+  }
+  return (timing_[unit].dts - start) / 90000.0;
+}
+
+size_t MediaSource::unitAtTime(double seconds, int fps) const {
+  if (timing_.empty()) {
+    return static_cast<size_t>(seconds * fps);
+  }
+  // dts 不晚于该时刻的最后一帧
+  int64_t t = timing_.front().dts + static_cast<int64_t>(seconds * 90000);
+  auto it = std::upper_bound(timing_.begin(), timing_.end(), t,
+                             [](int64_t value, const UnitTiming& timing) {
+                               return value < timing.dts;
+                             });
+  return it == timing_.begin() ? 0 : it - timing_.begin() - 1;
+}
+
+size_t MediaSource::paramNaluBefore(size_t nalu, uint8_t type) const {
+  const uint32_t* it =
+      std::lower_bound(param_nalus_, param_nalus_ + param_count_, nalu);
+  while (it != param_nalus_) {
+    --it;
+    if (nalus_[*it].type == type) {
+      return *it;
+    }
+  }
+  return size_t(-1);
+}
+
+bool MediaCursor::readNextAccessUnit(std::vector<NaluView>& nalus) {
+  nalus.clear();
+  if (eof()) {
+    return false;
+  }
+  const AccessUnitInfo& unit = source_->accessUnit(next_unit_++);
+  if (unit.is_key && (params_pending_ || repeat_params_)) {
+    appendParameterSets(unit, nalus);
+    params_pending_ = false;
+  }
+  uint8_t length_size = source_->nalLengthSize();
+  for (uint32_t i = 0; i < unit.nalu_count; ++i) {
+    NaluView nalu = source_->nalu(unit.first_nalu + i);
+    if (length_size == 0) {
+      nalus.push_back(nalu);
+      continue;
+    }
+    // MP4 样本：按长度前缀切出 NALU，视图直接指向映射的文件
+    const uint8_t* p = nalu.data;
+    const uint8_t* end = nalu.data + nalu.size;
+    while (size_t(end - p) > length_size) {
+      size_t size = 0;
+      for (uint8_t j = 0; j < length_size; ++j) {
+        size = (size << 8) | p[j];
       }
-      zero_count = 0;  // 01 但前面 0 不够，重置计数
-    } else {
-      zero_count = 0;  // 其他字符，重置计数
+      p += length_size;
+      if (size == 0 || size > size_t(end - p)) {
+        break;
+      }
+      nalus.push_back({p, size});
+      p += size;
     }
   }
+  return true;
+}
 
-  // 4. 处理 EOF 情况
-  // 如果读到了文件末尾，说明这是最后一个 NALU，它后面没有起始码了
-  if (nalu.data.size() > 0) {
-    nalu.is_valid = true;
+size_t MediaCursor::seekToKeyUnit(size_t unit) {
+  if (!source_ || source_->accessUnitCount() == 0) {
+    return 0;
+  }
+  unit = std::min(unit, source_->accessUnitCount() - 1);
+  next_unit_ = source_->keyUnitAtOrBefore(unit);
+  params_pending_ = true;
+  return next_unit_;
+}
+
+void MediaCursor::appendParameterSets(const AccessUnitInfo& unit,
+                                      std::vector<NaluView>& nalus) const {
+  // 该帧自带的参数集不需要补
+  ParameterSetTypes params = parameterSetTypes(source_->codec());
+  bool present[3] = {false, false, false};
+  for (uint32_t i = 0; i < unit.nalu_count; ++i) {
+    uint8_t type = source_->naluInfo(unit.first_nalu + i).type;
+    for (size_t j = 0; j < params.count; ++j) {
+      present[j] = present[j] || type == params.types[j];
+    }
+  }
+  for (size_t j = 0; j < params.count; ++j) {
+    if (present[j]) {
+      continue;
+    }
+    size_t nalu = source_->paramNaluBefore(unit.first_nalu, params.types[j]);
+    if (nalu != size_t(-1)) {
+      nalus.push_back(source_->nalu(nalu));
+    }
   }
-  return nalu;
-}
\ No newline at end of file
+}
@@ -1,9 +1,165 @@
 #pragma once
+#include <cstddef>
 #include <cstdint>
-#include <fstream>
+#include <memory>
+#include <string>
 #include <vector>
-struct Nalu {
-  std::vector<uint8_t> data;
-  bool is_valid = false;
-  static Nalu readNextNalu(std::ifstream& video_file);
+
+#include "audiofile.h"
+#include "global.h"
+
+// NALU 视图：指向读取缓冲区中的数据（不含起始码），本身不拥有内存
+struct NaluView {
+  const uint8_t* data = nullptr;
+  size_t size = 0;
+  bool empty() const { return size == 0; }
+};
+
+// 在 [begin, end) 中查找起始码 00 00 01，返回指向第一个 00 的指针，找不到返回 end
+// 用 memchr 找 0x01 再回看前两个字节，比逐字节比较快得多
+const uint8_t* findStartCode(const uint8_t* begin, const uint8_t* end);
+
+// 索引中的一个 NALU（不含起始码），同时也是索引文件中的记录格式
+struct NaluInfo {
+  uint64_t offset = 0;  // 在文件中的偏移
+  uint32_t size = 0;
+  uint8_t type = 0;  // nal_unit_type，按文件的编码（H.264 或 H.265）解释
+  uint8_t reserved[3] = {0, 0, 0};
+};
+
+// 一个访问单元（一帧）由若干连续的 NALU 组成
+struct AccessUnitInfo {
+  uint32_t first_nalu = 0;
+  uint32_t nalu_count = 0;
+  uint8_t is_key = 0;  // 包含 IDR
+  uint8_t reserved[3] = {0, 0, 0};
+};
+
+// 容器（MP4）给出的帧时间，单位 90kHz；裸码流没有，按固定帧率推算
+struct UnitTiming {
+  int64_t dts = 0;
+  uint32_t duration = 0;
+  int32_t cts = 0;  // 显示时间 - 解码时间
+};
+
+// 码流的参数集类型（H.264 SPS/PPS，H.265 VPS/SPS/PPS），按在码流中应有的先后顺序
+struct ParameterSetTypes {
+  uint8_t types[3];
+  size_t count;
+};
+ParameterSetTypes parameterSetTypes(CodecId codec);
+// 按扩展名判断编码：.h265/.265/.hevc 为 H.265，其余按 H.264 处理
+CodecId codecFromPath(const std::string& path);
+
+// 映射到内存并建好索引的 H.264/H.265 文件，只读，可被任意多个会话共享
+// 索引会写到旁边的 <文件名>.idx 中，下次启动时直接映射，不再重新扫描
+// MP4 直接用 moov/moof 里的样本表：每个样本是一个 NALU 表项（带长度前缀的若干 NALU），
+// 参数集指向 avcC/hvcC 中的数据，都不拷贝；读取时才按长度前缀切分
+class MediaSource {
+ public:
+  // 同一路径只打开、索引一次，后续直接返回已有的实例；失败返回 nullptr
+  // 同一路径并发打开时后来的调用者等待第一个打开完成，不同路径互不阻塞
+  static std::shared_ptr<const MediaSource> open(const std::string& path);
+  ~MediaSource();
+  MediaSource(const MediaSource&) = delete;
+  MediaSource& operator=(const MediaSource&) = delete;
+
+  const std::string& path() const { return path_; }
+  CodecId codec() const { return codec_; }
+  // 同名的音频文件（track1），没有则为空
+  const std::shared_ptr<const AudioSource>& audio() const { return audio_; }
+  // MP4 样本中 NALU 长度前缀的字节数，Annex-B 为 0
+  uint8_t nalLengthSize() const { return nal_length_size_; }
+  bool hasTiming() const { return !timing_.empty(); }
+  const UnitTiming& unitTiming(size_t unit) const { return timing_[unit]; }
+  // 帧序号与秒数互换，没有时间戳时按 fps 推算；unit 可以等于帧数，即总时长
+  double unitTime(size_t unit, int fps) const;
+  size_t unitAtTime(double seconds, int fps) const;
+  size_t naluCount() const { return nalu_count_; }
+  const NaluInfo& naluInfo(size_t index) const { return nalus_[index]; }
+  NaluView nalu(size_t index) const {
+    return {data_ + nalus_[index].offset, nalus_[index].size};
+  }
+  size_t accessUnitCount() const { return unit_count_; }
+  const AccessUnitInfo& accessUnit(size_t index) const {
+    return units_[index];
+  }
+  // 不晚于 unit 的最近一个 IDR 帧的序号，没有则返回 0
+  size_t keyUnitAtOrBefore(size_t unit) const;
+  // 在 nalu 之前最近的一个 type 类型参数集的 NALU 序号，没有则返回 -1
+  size_t paramNaluBefore(size_t nalu, uint8_t type) const;
+
+ private:
+  explicit MediaSource(const std::string& path);
+  // 映射文件并建立或加载索引，不访问已打开的表
+  static std::shared_ptr<const MediaSource> load(const std::string& path);
+  bool mapFile();
+  std::string indexPath() const { return path_ + ".idx"; }
+  bool loadIndex();
+  void buildIndex();
+  bool loadMp4();
+  // 把各个表按索引文件的格式放到 index_buffer_ 中并设置指针
+  void packIndex(const std::vector<NaluInfo>& nalus,
+                 const std::vector<AccessUnitInfo>& units,
+                 const std::vector<uint32_t>& key_units,
+                 const std::vector<uint32_t>& param_nalus);
+  void saveIndex() const;
+  // 按索引文件格式解析 [data, data + size)，设置各个表的指针
+  bool attachIndex(const uint8_t* data, size_t size);
+  // 检查已设置的各个表：偏移、长度和序号都在范围内
+  bool validIndex() const;
+
+  std::string path_;
+  CodecId codec_;
+  std::shared_ptr<const AudioSource> audio_;
+  uint8_t nal_length_size_ = 0;
+  std::vector<UnitTiming> timing_;
+  const uint8_t* data_ = nullptr;
+  size_t size_ = 0;
+  int64_t mtime_ns_ = 0;
+
+  // 索引表，指向 index_map_（来自索引文件）或 index_buffer_（刚建立的）
+  const NaluInfo* nalus_ = nullptr;
+  size_t nalu_count_ = 0;
+  const AccessUnitInfo* units_ = nullptr;
+  size_t unit_count_ = 0;
+  const uint32_t* key_units_ = nullptr;  // IDR 帧的序号
+  size_t key_count_ = 0;
+  const uint32_t* param_nalus_ = nullptr;  // 参数集的 NALU 序号
+  size_t param_count_ = 0;
+  const uint8_t* index_map_ = nullptr;
+  size_t index_map_size_ = 0;
+  std::vector<uint8_t> index_buffer_;
+};
+
+// 会话在共享索引上的读取位置，会话本身只保存这个游标，按帧（访问单元）读取
+class MediaCursor {
+ public:
+  MediaCursor() = default;
+  // 第一个关键帧也按需补上参数集，MP4 的参数集只在 avcC/hvcC 里
+  explicit MediaCursor(std::shared_ptr<const MediaSource> source)
+      : source_(std::move(source)), params_pending_(true) {}
+  bool isOpen() const { return source_ != nullptr; }
+  bool eof() const {
+    return !source_ || next_unit_ >= source_->accessUnitCount();
+  }
+  // 读取下一帧的所有 NALU 到 nalus（会先清空），没有更多帧时返回 false
+  bool readNextAccessUnit(std::vector<NaluView>& nalus);
+  // 下一个要读取的帧序号
+  size_t position() const { return next_unit_; }
+  // 跳到不晚于 unit 的最近 IDR 帧，返回实际跳到的帧序号
+  // 若该帧没有自带参数集（SPS/PPS，H.265 还有 VPS），读取时会先补上最近的
+  size_t seekToKeyUnit(size_t unit);
+  // 每个不带参数集的关键帧前都补上参数集，直播时中途加入的观看者需要
+  void setRepeatParameterSets(bool repeat) { repeat_params_ = repeat; }
+  const std::shared_ptr<const MediaSource>& source() const { return source_; }
+
+ private:
+  void appendParameterSets(const AccessUnitInfo& unit,
+                           std::vector<NaluView>& nalus) const;
+
+  std::shared_ptr<const MediaSource> source_;
+  size_t next_unit_ = 0;
+  bool params_pending_ = false;
+  bool repeat_params_ = false;
 };
@@ -0,0 +1,117 @@
+#include "metrics.h"
+
+#include <algorithm>
+#include <iostream>
+#include <sstream>
+
+#include "asioioservicepool.h"
+
+std::shared_ptr<SessionStats> Metrics::createSessionStats(
+    const std::string& id) {
+  auto stats = std::make_shared<SessionStats>(id);
+  std::lock_guard<std::mutex> lock(mtx_);
+  // 顺便清理已结束的会话
+  sessions_.erase(
+      std::remove_if(sessions_.begin(), sessions_.end(),
+                     [](const std::weak_ptr<SessionStats>& s) {
+                       return s.expired();
+                     }),
+      sessions_.end());
+  sessions_.push_back(stats);
+  return stats;
+}
+
+std::string Metrics::render() {
+  std::vector<std::shared_ptr<SessionStats>> sessions;
+  {
+    std::lock_guard<std::mutex> lock(mtx_);
+    for (auto& weak : sessions_) {
+      if (auto stats = weak.lock()) {
+        sessions.push_back(stats);
+      }
+    }
+  }
+  std::stringstream ss;
+  ss << "rtsp_sessions " << sessions.size() << "\n";
+  ss << "rtp_batch_pool_allocated_total " << batch_pool_allocated << "\n";
+  ss << "rtp_batch_pool_reused_total " << batch_pool_reused << "\n";
+  ss << "rtp_batch_buffer_grown_total " << batch_buffer_grown << "\n";
+  ss << "io_uring_enter_calls_total " << io_uring_enter_calls << "\n";
+  ss << "io_uring_sqes_total " << io_uring_sqes << "\n";
+  ss << "io_uring_send_errors_total " << io_uring_send_errors << "\n";
+  // 各网络线程的会话数和发送字节数，用来检查会话是否分布均匀
+  auto pool = AsioIOServicePool::GetInstance();
+  for (size_t i = 0; i < pool->size(); ++i) {
+    ss << "io_thread_sessions{thread=\"" << i << "\"} "
+       << pool->load(i).sessions << "\n";
+    ss << "io_thread_octets_sent_total{thread=\"" << i << "\"} "
+       << pool->load(i).octets << "\n";
+  }
+  auto counter = [&ss, &sessions](const char* name, auto getter) {
+    for (auto& stats : sessions) {
+      ss << name << "{session=\"" << stats->session_id << "\"} "
+         << getter(*stats) << "\n";
+    }
+  };
+  counter("rtp_packets_sent_total",
+          [](SessionStats& s) { return s.rtp_packets.load(); });
+  counter("rtp_octets_sent_total",
+          [](SessionStats& s) { return s.rtp_octets.load(); });
+  counter("rtcp_sr_sent_total",
+          [](SessionStats& s) { return s.rtcp_sr_sent.load(); });
+  counter("rtcp_rr_received_total",
+          [](SessionStats& s) { return s.rtcp_rr_received.load(); });
+  counter("rtcp_nack_received_total",
+          [](SessionStats& s) { return s.nack_received.load(); });
+  counter("rtp_retransmitted_total",
+          [](SessionStats& s) { return s.rtp_retransmitted.load(); });
+  counter("rtcp_fraction_lost",
+          [](SessionStats& s) { return s.fraction_lost.load() / 256.0; });
+  counter("rtcp_cumulative_lost",
+          [](SessionStats& s) { return s.cumulative_lost.load(); });
+  counter("rtcp_jitter_ms",
+          [](SessionStats& s) { return s.jitter.load() / 90.0; });
+  counter("rtcp_rtt_ms",
+          [](SessionStats& s) { return s.rtt_us.load() / 1000.0; });
+  counter("prefetch_underruns_total",
+          [](SessionStats& s) { return s.prefetch_underruns.load(); });
+  return ss.str();
+}
+
+MetricsServer::MetricsServer(net::io_context& ioc, uint16_t port)
+    : acceptor_(ioc, tcp::endpoint(tcp::v4(), port)) {}
+
+void MetricsServer::start() {
+  auto self = shared_from_this();
+  auto socket = std::make_shared<tcp::socket>(acceptor_.get_executor());
+  acceptor_.async_accept(*socket, [self, socket](boost::system::error_code ec) {
+    if (ec) {
+      if (ec != net::error::operation_aborted) {
+        self->start();
+      }
+      return;
+    }
+    // 读完请求头就回复当前指标，不区分路径
+    auto request = std::make_shared<net::streambuf>(4096);
+    net::async_read_until(
+        *socket, *request, "\r\n\r\n",
+        [socket, request](boost::system::error_code ec, size_t) {
+          if (ec) {
+            return;
+          }
+          std::string body = Metrics::GetInstance()->render();
+          auto response = std::make_shared<std::string>(
+              "HTTP/1.0 200 OK\r\nContent-Type: text/plain; version=0.0.4\r\n"
+              "Content-Length: " +
+              std::to_string(body.size()) +
+              "\r\nConnection: close\r\n\r\n" + body);
+          net::async_write(
+              *socket, net::buffer(*response),
+              [socket, response](boost::system::error_code, size_t) {
+                boost::system::error_code ignored;
+                socket->shutdown(tcp::socket::shutdown_both, ignored);
+              });
+        });
+    self->start();
+  });
+}
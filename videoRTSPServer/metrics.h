@@ -0,0 +1,62 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "global.h"
+#include "singleton.h"
+
+// 单个会话的 QoS 计数，会话线程写、采集线程读，全部用原子变量
+struct SessionStats {
+  explicit SessionStats(std::string id) : session_id(std::move(id)) {}
+  const std::string session_id;
+  std::atomic<uint64_t> rtp_packets{0};
+  std::atomic<uint64_t> rtp_octets{0};
+  std::atomic<uint64_t> rtcp_sr_sent{0};
+  std::atomic<uint64_t> rtcp_rr_received{0};
+  std::atomic<uint64_t> nack_received{0};  // 被请求重传的包数
+  std::atomic<uint64_t> rtp_retransmitted{0};
+  std::atomic<uint32_t> fraction_lost{0};  // 最近一次 RR，单位 1/256
+  std::atomic<int64_t> cumulative_lost{0};
+  std::atomic<uint32_t> jitter{0};         // RTP 时钟单位
+  std::atomic<uint32_t> rtt_us{0};
+  // 定时器到了预读的帧还没读好的次数，持续增长说明磁盘跟不上
+  std::atomic<uint64_t> prefetch_underruns{0};
+};
+
+// 全局指标：会话注册自己的计数，采集时输出 Prometheus 文本格式
+class Metrics : public Singleton<Metrics> {
+  friend class Singleton<Metrics>;
+
+ public:
+  std::shared_ptr<SessionStats> createSessionStats(const std::string& id);
+  std::string render();
+
+  // RTPBatch 池：新建节点数、复用次数、包数组扩容次数，稳定后应该只有复用在增长
+  std::atomic<uint64_t> batch_pool_allocated{0};
+  std::atomic<uint64_t> batch_pool_reused{0};
+  std::atomic<uint64_t> batch_buffer_grown{0};
+  // io_uring 发送：io_uring_enter 调用次数、提交的报文数和发送失败数，
+  // 报文数与调用次数之比即为每次系统调用合并的报文数
+  std::atomic<uint64_t> io_uring_enter_calls{0};
+  std::atomic<uint64_t> io_uring_sqes{0};
+  std::atomic<uint64_t> io_uring_send_errors{0};
+
+ private:
+  Metrics() = default;
+  std::mutex mtx_;
+  std::vector<std::weak_ptr<SessionStats>> sessions_;
+};
+
+// 极简 HTTP 服务，任何请求都返回当前指标，供 Prometheus 采集
+class MetricsServer : public std::enable_shared_from_this<MetricsServer> {
+ public:
+  MetricsServer(net::io_context& ioc, uint16_t port);
+  void start();
+
+ private:
+  tcp::acceptor acceptor_;
+};
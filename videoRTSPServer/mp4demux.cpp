@@ -0,0 +1,743 @@
+#include "mp4demux.h"
+
+#include <cstring>
+#include <iostream>
+
+namespace {
+// 大端读取，越界后 ok 置为 false，之后读到的都是 0
+class BoxReader {
+ public:
+  BoxReader(const uint8_t* begin, const uint8_t* end)
+      : begin_(begin), p_(begin), end_(end) {}
+  uint8_t u8() { return static_cast<uint8_t>(read(1)); }
+  uint16_t u16() { return static_cast<uint16_t>(read(2)); }
+  uint32_t u24() { return static_cast<uint32_t>(read(3)); }
+  uint32_t u32() { return static_cast<uint32_t>(read(4)); }
+  uint64_t u64() { return read(8); }
+  void skip(size_t n) {
+    if (remaining() < n) {
+      ok_ = false;
+      p_ = end_;
+      return;
+    }
+    p_ += n;
+  }
+  const uint8_t* pos() const { return p_; }
+  size_t offset() const { return p_ - begin_; }
+  size_t remaining() const { return end_ - p_; }
+  bool ok() const { return ok_; }
+
+ private:
+  uint64_t read(size_t n) {
+    if (remaining() < n) {
+      ok_ = false;
+      p_ = end_;
+      return 0;
+    }
+    uint64_t value = 0;
+    for (size_t i = 0; i < n; ++i) {
+      value = (value << 8) | p_[i];
+    }
+    p_ += n;
+    return value;
+  }
+
+  const uint8_t* begin_;
+  const uint8_t* p_;
+  const uint8_t* end_;
+  bool ok_ = true;
+};
+
+// 一个 box 的类型和内容范围（不含头）
+struct Box {
+  uint32_t type = 0;
+  const uint8_t* begin = nullptr;  // box 头的起点
+  const uint8_t* data = nullptr;
+  const uint8_t* end = nullptr;
+};
+
+constexpr uint32_t fourcc(const char (&s)[5]) {
+  return (uint32_t(uint8_t(s[0])) << 24) | (uint32_t(uint8_t(s[1])) << 16) |
+         (uint32_t(uint8_t(s[2])) << 8) | uint32_t(uint8_t(s[3]));
+}
+
+// 依次取出 [p, end) 中的子 box，结构损坏时返回 false
+bool nextBox(const uint8_t*& p, const uint8_t* end, Box& box) {
+  if (end - p < 8) {
+    return false;
+  }
+  BoxReader reader(p, end);
+  uint64_t size = reader.u32();
+  box.type = reader.u32();
+  if (size == 1) {
+    size = reader.u64();
+  } else if (size == 0) {
+    size = end - p;  // 延伸到文件末尾
+  }
+  if (!reader.ok() || size < reader.offset() || size > uint64_t(end - p)) {
+    return false;
+  }
+  box.begin = p;
+  box.data = p + reader.offset();
+  box.end = p + size;
+  p = box.end;
+  return true;
+}
+
+// 在 [begin, end) 的直接子 box 中找 type，找不到返回 false
+bool findBox(const uint8_t* begin, const uint8_t* end, uint32_t type,
+             Box& out) {
+  Box box;
+  while (nextBox(begin, end, box)) {
+    if (box.type == type) {
+      out = box;
+      return true;
+    }
+  }
+  return false;
+}
+
+// stbl 中与样本展开有关的表，只记录位置，最后一起展开
+struct SampleTables {
+  Box stts, ctts, stss, stsz, stz2, stsc, stco, co64;
+  bool has_stss = false;
+};
+
+// trex 中的分片默认值
+struct TrackDefaults {
+  uint32_t duration = 0;
+  uint32_t size = 0;
+  uint32_t flags = 0;
+};
+
+// 分片样本的 sample_is_non_sync_sample 标志
+constexpr uint32_t kNonSyncFlag = 0x10000;
+
+// MPEG-4 描述符的长度：每字节 7 位，最高位表示还有后续
+uint32_t descriptorLength(BoxReader& reader) {
+  uint32_t length = 0;
+  for (int i = 0; i < 4; ++i) {
+    uint8_t b = reader.u8();
+    length = (length << 7) | (b & 0x7F);
+    if (!(b & 0x80)) {
+      break;
+    }
+  }
+  return length;
+}
+
+class Mp4Parser {
+ public:
+  Mp4Parser(const uint8_t* data, size_t size) : data_(data), size_(size) {}
+  bool parse(std::vector<Mp4Track>& tracks);
+
+ private:
+  uint64_t offsetOf(const uint8_t* p) const { return p - data_; }
+  bool parseTrak(const Box& trak);
+  void parseStsd(const Box& stsd, Mp4Track& track);
+  void parseAvcC(const Box& box, Mp4Track& track);
+  void parseHvcC(const Box& box, Mp4Track& track);
+  void parseEsds(const Box& box, Mp4Track& track);
+  bool buildSamples(const SampleTables& tables, Mp4Track& track);
+  void parseMoof(const Box& moof);
+  void parseTraf(const Box& moof, const Box& traf);
+  Mp4Track* findTrack(uint32_t track_id);
+
+  const uint8_t* data_;
+  size_t size_;
+  std::vector<Mp4Track> tracks_;
+  std::vector<std::pair<uint32_t, TrackDefaults>> defaults_;  // trex
+  std::vector<int64_t> next_dts_;  // 没有 tfdt 时各轨道接着上一个分片
+};
+
+bool Mp4Parser::parse(std::vector<Mp4Track>& tracks) {
+  const uint8_t* p = data_;
+  const uint8_t* end = data_ + size_;
+  Box box;
+  bool has_moov = false;
+  while (nextBox(p, end, box)) {
+    if (box.type == fourcc("moov")) {
+      has_moov = true;
+      Box child;
+      const uint8_t* q = box.data;
+      while (nextBox(q, box.end, child)) {
+        if (child.type == fourcc("trak")) {
+          parseTrak(child);
+        } else if (child.type == fourcc("mvex")) {
+          Box trex;
+          const uint8_t* r = child.data;
+          while (nextBox(r, child.end, trex)) {
+            if (trex.type != fourcc("trex")) {
+              continue;
+            }
+            BoxReader reader(trex.data, trex.end);
+            reader.skip(4);  // version + flags
+            uint32_t track_id = reader.u32();
+            reader.skip(4);  // default_sample_description_index
+            TrackDefaults defaults;
+            defaults.duration = reader.u32();
+            defaults.size = reader.u32();
+            defaults.flags = reader.u32();
+            if (reader.ok()) {
+              defaults_.emplace_back(track_id, defaults);
+            }
+          }
+        }
+      }
+      // 分片接在 moov 的样本之后，最后一个样本的时长按前一个估计，有 tfdt 时以它为准
+      next_dts_.assign(tracks_.size(), 0);
+      for (size_t i = 0; i < tracks_.size(); ++i) {
+        const auto& samples = tracks_[i].samples;
+        if (samples.size() >= 2) {
+          next_dts_[i] =
+              2 * samples.back().dts - samples[samples.size() - 2].dts;
+        }
+      }
+    } else if (box.type == fourcc("moof") && has_moov) {
+      parseMoof(box);
+    }
+  }
+  if (!has_moov) {
+    return false;
+  }
+  tracks.clear();
+  for (Mp4Track& track : tracks_) {
+    if (!track.samples.empty()) {
+      tracks.push_back(std::move(track));
+    }
+  }
+  return !tracks.empty();
+}
+
+bool Mp4Parser::parseTrak(const Box& trak) {
+  Mp4Track track;
+  Box tkhd, mdia, mdhd, hdlr, minf, stbl;
+  if (!findBox(trak.data, trak.end, fourcc("tkhd"), tkhd) ||
+      !findBox(trak.data, trak.end, fourcc("mdia"), mdia) ||
+      !findBox(mdia.data, mdia.end, fourcc("mdhd"), mdhd) ||
+      !findBox(mdia.data, mdia.end, fourcc("hdlr"), hdlr) ||
+      !findBox(mdia.data, mdia.end, fourcc("minf"), minf) ||
+      !findBox(minf.data, minf.end, fourcc("stbl"), stbl)) {
+    return false;
+  }
+  {
+    BoxReader reader(tkhd.data, tkhd.end);
+    uint8_t version = reader.u8();
+    reader.skip(3 + (version == 1 ? 16 : 8));
+    track.track_id = reader.u32();
+  }
+  {
+    BoxReader reader(mdhd.data, mdhd.end);
+    uint8_t version = reader.u8();
+    reader.skip(3 + (version == 1 ? 16 : 8));
+    track.timescale = reader.u32();
+  }
+  {
+    BoxReader reader(hdlr.data, hdlr.end);
+    reader.skip(8);  // version + flags + pre_defined
+    uint32_t handler = reader.u32();
+    if (handler == fourcc("vide")) {
+      track.type = MediaType::VIDEO;
+    } else if (handler == fourcc("soun")) {
+      track.type = MediaType::AUDIO;
+    }
+  }
+  if (track.type == MediaType::NONE || track.timescale == 0) {
+    return false;
+  }
+
+  SampleTables tables;
+  Box box;
+  const uint8_t* p = stbl.data;
+  while (nextBox(p, stbl.end, box)) {
+    switch (box.type) {
+      case fourcc("stsd"):
+        parseStsd(box, track);
+        break;
+      case fourcc("stts"):
+        tables.stts = box;
+        break;
+      case fourcc("ctts"):
+        tables.ctts = box;
+        break;
+      case fourcc("stss"):
+        tables.stss = box;
+        tables.has_stss = true;
+        break;
+      case fourcc("stsz"):
+        tables.stsz = box;
+        break;
+      case fourcc("stz2"):
+        tables.stz2 = box;
+        break;
+      case fourcc("stsc"):
+        tables.stsc = box;
+        break;
+      case fourcc("stco"):
+        tables.stco = box;
+        break;
+      case fourcc("co64"):
+        tables.co64 = box;
+        break;
+      default:
+        break;
+    }
+  }
+  // stsd 中不是能处理的编码
+  if (track.type == MediaType::VIDEO && track.codec != CodecId::H264 &&
+      track.codec != CodecId::H265) {
+    return false;
+  }
+  if (track.type == MediaType::AUDIO && track.codec != CodecId::AAC) {
+    return false;
+  }
+  // 分片文件的 moov 里样本表为空，样本在后面的 moof 中
+  if (!buildSamples(tables, track)) {
+    std::cerr << "bad sample table in track " << track.track_id << std::endl;
+    return false;
+  }
+  tracks_.push_back(std::move(track));
+  return true;
+}
+
+void Mp4Parser::parseStsd(const Box& stsd, Mp4Track& track) {
+  BoxReader reader(stsd.data, stsd.end);
+  reader.skip(8);  // version + flags + entry_count
+  if (!reader.ok()) {
+    return;
+  }
+  // 只看第一个样本描述
+  Box entry;
+  const uint8_t* p = reader.pos();
+  if (!nextBox(p, stsd.end, entry)) {
+    return;
+  }
+  // 标记为不支持，下面认出编码后再改
+  track.codec = CodecId::PCMU;
+  if (track.type == MediaType::VIDEO) {
+    bool avc = entry.type == fourcc("avc1") || entry.type == fourcc("avc3");
+    bool hevc = entry.type == fourcc("hvc1") || entry.type == fourcc("hev1");
+    if (!avc && !hevc) {
+      return;
+    }
+    track.codec = avc ? CodecId::H264 : CodecId::H265;
+    // VisualSampleEntry 固定 78 字节，之后是 avcC/hvcC 等子 box
+    if (entry.end - entry.data < 78) {
+      return;
+    }
+    Box config;
+    if (avc && findBox(entry.data + 78, entry.end, fourcc("avcC"), config)) {
+      parseAvcC(config, track);
+    } else if (hevc &&
+               findBox(entry.data + 78, entry.end, fourcc("hvcC"), config)) {
+      parseHvcC(config, track);
+    }
+    return;
+  }
+  if (entry.type != fourcc("mp4a")) {
+    return;
+  }
+  track.codec = CodecId::AAC;
+  // AudioSampleEntry：8 字节 SampleEntry + version(2) ... 共 28 字节，
+  // QuickTime 的 version 1/2 声音描述后面还有 16/36 字节
+  BoxReader entry_reader(entry.data, entry.end);
+  entry_reader.skip(8);
+  uint16_t version = entry_reader.u16();
+  entry_reader.skip(6);
+  track.channels = entry_reader.u16();
+  entry_reader.skip(6);
+  track.sample_rate = entry_reader.u32() >> 16;
+  size_t extra = version == 1 ? 16 : version == 2 ? 36 : 0;
+  if (!entry_reader.ok() || entry.end - entry.data < 28 + ptrdiff_t(extra)) {
+    return;
+  }
+  Box esds;
+  if (findBox(entry.data + 28 + extra, entry.end, fourcc("esds"), esds)) {
+    parseEsds(esds, track);
+  }
+}
+
+void Mp4Parser::parseAvcC(const Box& box, Mp4Track& track) {
+  // AVCDecoderConfigurationRecord（ISO 14496-15 5.3.3.1）
+  BoxReader reader(box.data, box.end);
+  reader.skip(4);  // version, profile, compatibility, level
+  track.nal_length_size = (reader.u8() & 0x03) + 1;
+  for (int kind = 0; kind < 2 && reader.ok(); ++kind) {
+    // 先是 SPS（数量占低 5 位），再是 PPS
+    uint8_t count = reader.u8();
+    if (kind == 0) {
+      count &= 0x1F;
+    }
+    for (uint8_t i = 0; i < count && reader.ok(); ++i) {
+      uint16_t size = reader.u16();
+      Mp4Range range;
+      range.offset = offsetOf(reader.pos());
+      range.size = size;
+      reader.skip(size);
+      if (reader.ok() && size > 0) {
+        track.parameter_sets.push_back(range);
+      }
+    }
+  }
+}
+
+void Mp4Parser::parseHvcC(const Box& box, Mp4Track& track) {
+  // HEVCDecoderConfigurationRecord（ISO 14496-15 8.3.3.1）：22 字节的头，
+  // 第 21 字节低 2 位为 lengthSizeMinusOne，之后是按 NALU 类型分组的数组
+  BoxReader reader(box.data, box.end);
+  reader.skip(21);
+  track.nal_length_size = (reader.u8() & 0x03) + 1;
+  uint8_t arrays = reader.u8();
+  for (uint8_t i = 0; i < arrays && reader.ok(); ++i) {
+    reader.skip(1);  // array_completeness + NAL_unit_type
+    uint16_t count = reader.u16();
+    for (uint16_t j = 0; j < count && reader.ok(); ++j) {
+      uint16_t size = reader.u16();
+      Mp4Range range;
+      range.offset = offsetOf(reader.pos());
+      range.size = size;
+      reader.skip(size);
+      if (reader.ok() && size > 0) {
+        track.parameter_sets.push_back(range);
+      }
+    }
+  }
+}
+
+void Mp4Parser::parseEsds(const Box& box, Mp4Track& track) {
+  // ES_Descriptor(0x03) -> DecoderConfigDescriptor(0x04) -> DecSpecificInfo(0x05)
+  BoxReader reader(box.data, box.end);
+  reader.skip(4);  // version + flags
+  if (reader.u8() != 0x03) {
+    return;
+  }
+  descriptorLength(reader);
+  reader.skip(2);  // ES_ID
+  uint8_t flags = reader.u8();
+  if (flags & 0x80) {
+    reader.skip(2);  // dependsOn_ES_ID
+  }
+  if (flags & 0x40) {
+    reader.skip(reader.u8());  // URL
+  }
+  if (flags & 0x20) {
+    reader.skip(2);  // OCR_ES_Id
+  }
+  if (reader.u8() != 0x04) {
+    return;
+  }
+  descriptorLength(reader);
+  reader.skip(13);  // objectType, streamType, bufferSize, maxBitrate, avgBitrate
+  if (reader.u8() != 0x05) {
+    return;
+  }
+  uint32_t size = descriptorLength(reader);
+  if (reader.ok() && size > 0 && size <= reader.remaining()) {
+    track.audio_config.offset = offsetOf(reader.pos());
+    track.audio_config.size = size;
+  }
+}
+
+bool Mp4Parser::buildSamples(const SampleTables& tables, Mp4Track& track) {
+  // 样本大小：stsz（sample_size 非 0 时全部相同）或紧凑的 stz2
+  std::vector<uint32_t> sizes;
+  if (tables.stsz.data) {
+    BoxReader reader(tables.stsz.data, tables.stsz.end);
+    reader.skip(4);
+    uint32_t sample_size = reader.u32();
+    uint32_t count = reader.u32();
+    if (!reader.ok() || (sample_size == 0 && count > reader.remaining() / 4)) {
+      return false;
+    }
+    sizes.resize(count, sample_size);
+    for (uint32_t i = 0; sample_size == 0 && i < count; ++i) {
+      sizes[i] = reader.u32();
+    }
+  } else if (tables.stz2.data) {
+    BoxReader reader(tables.stz2.data, tables.stz2.end);
+    reader.skip(7);
+    uint8_t field_size = reader.u8();
+    uint32_t count = reader.u32();
+    if (!reader.ok() || (field_size != 4 && field_size != 8 &&
+                         field_size != 16)) {
+      return false;
+    }
+    if ((uint64_t(count) * field_size + 7) / 8 > reader.remaining()) {
+      return false;
+    }
+    sizes.resize(count);
+    const uint8_t* fields = reader.pos();
+    for (uint32_t i = 0; i < count; ++i) {
+      if (field_size == 16) {
+        sizes[i] = (fields[2 * i] << 8) | fields[2 * i + 1];
+      } else if (field_size == 8) {
+        sizes[i] = fields[i];
+      } else {
+        // 两个样本共用一个字节，高 4 位在前
+        sizes[i] = i % 2 == 0 ? fields[i / 2] >> 4 : fields[i / 2] & 0x0F;
+      }
+    }
+  }
+  if (sizes.empty()) {
+    return true;
+  }
+
+  // 块偏移
+  std::vector<uint64_t> chunks;
+  if (tables.stco.data || tables.co64.data) {
+    bool wide = tables.co64.data != nullptr;
+    const Box& box = wide ? tables.co64 : tables.stco;
+    BoxReader reader(box.data, box.end);
+    reader.skip(4);
+    uint32_t count = reader.u32();
+    if (!reader.ok() || count > reader.remaining() / (wide ? 8 : 4)) {
+      return false;
+    }
+    chunks.resize(count);
+    for (uint32_t i = 0; i < count; ++i) {
+      chunks[i] = wide ? reader.u64() : reader.u32();
+    }
+  }
+
+  // 按 stsc 把样本分到各个块，块内样本连续存放
+  track.samples.resize(sizes.size());
+  BoxReader stsc(tables.stsc.data, tables.stsc.end);
+  stsc.skip(4);
+  uint32_t entries = tables.stsc.data ? stsc.u32() : 0;
+  if (!stsc.ok() || entries == 0 || entries > stsc.remaining() / 12) {
+    return false;
+  }
+  size_t sample = 0;
+  uint32_t first_chunk = stsc.u32();
+  uint32_t per_chunk = stsc.u32();
+  stsc.skip(4);
+  // 块号从 1 开始，各项的起始块号必须严格递增
+  if (first_chunk == 0) {
+    return false;
+  }
+  for (uint32_t e = 0; e < entries && sample < sizes.size(); ++e) {
+    uint32_t next_first = chunks.size() + 1;
+    uint32_t next_per_chunk = 0;
+    if (e + 1 < entries) {
+      next_first = stsc.u32();
+      next_per_chunk = stsc.u32();
+      stsc.skip(4);
+      if (next_first <= first_chunk) {
+        return false;
+      }
+    }
+    for (uint32_t chunk = first_chunk;
+         chunk < next_first && chunk <= chunks.size() && sample < sizes.size();
+         ++chunk) {
+      uint64_t offset = chunks[chunk - 1];
+      for (uint32_t i = 0; i < per_chunk && sample < sizes.size(); ++i) {
+        track.samples[sample].offset = offset;
+        track.samples[sample].size = sizes[sample];
+        offset += sizes[sample];
+        ++sample;
+      }
+    }
+    first_chunk = next_first;
+    per_chunk = next_per_chunk;
+  }
+  if (sample != sizes.size()) {
+    return false;
+  }
+  // co64 的偏移可能很大，先比偏移再比长度，避免相加溢出
+  for (const Mp4Sample& s : track.samples) {
+    if (s.offset > size_ || s.size > size_ - s.offset) {
+      return false;
+    }
+  }
+
+  // 解码时间：stts 为 (样本数, 时长) 的游程
+  {
+    BoxReader reader(tables.stts.data, tables.stts.end);
+    reader.skip(4);
+    uint32_t count = tables.stts.data ? reader.u32() : 0;
+    size_t i = 0;
+    int64_t dts = 0;
+    for (uint32_t e = 0; e < count && reader.ok(); ++e) {
+      uint32_t run = reader.u32();
+      uint32_t delta = reader.u32();
+      for (uint32_t j = 0; j < run && i < track.samples.size(); ++j) {
+        track.samples[i++].dts = dts;
+        dts += delta;
+      }
+    }
+    for (; i < track.samples.size(); ++i) {
+      track.samples[i].dts = dts;
+    }
+  }
+  // 显示时间偏移：ctts 的游程，version 1 为有符号数
+  if (tables.ctts.data) {
+    BoxReader reader(tables.ctts.data, tables.ctts.end);
+    reader.skip(4);
+    uint32_t count = reader.u32();
+    size_t i = 0;
+    for (uint32_t e = 0; e < count && reader.ok(); ++e) {
+      uint32_t run = reader.u32();
+      int32_t offset = static_cast<int32_t>(reader.u32());
+      for (uint32_t j = 0; j < run && i < track.samples.size(); ++j) {
+        track.samples[i++].cts = offset;
+      }
+    }
+  }
+  // 同步样本：没有 stss 时全部都是
+  if (tables.has_stss) {
+    for (Mp4Sample& s : track.samples) {
+      s.sync = false;
+    }
+    BoxReader reader(tables.stss.data, tables.stss.end);
+    reader.skip(4);
+    uint32_t count = reader.u32();
+    for (uint32_t e = 0; e < count && reader.ok(); ++e) {
+      uint32_t number = reader.u32();
+      if (number >= 1 && number <= track.samples.size()) {
+        track.samples[number - 1].sync = true;
+      }
+    }
+  }
+  return true;
+}
+
+Mp4Track* Mp4Parser::findTrack(uint32_t track_id) {
+  for (Mp4Track& track : tracks_) {
+    if (track.track_id == track_id) {
+      return &track;
+    }
+  }
+  return nullptr;
+}
+
+void Mp4Parser::parseMoof(const Box& moof) {
+  Box traf;
+  const uint8_t* p = moof.data;
+  while (nextBox(p, moof.end, traf)) {
+    if (traf.type == fourcc("traf")) {
+      parseTraf(moof, traf);
+    }
+  }
+}
+
+void Mp4Parser::parseTraf(const Box& moof, const Box& traf) {
+  Box tfhd;
+  if (!findBox(traf.data, traf.end, fourcc("tfhd"), tfhd)) {
+    return;
+  }
+  // tfhd（ISO 14496-12 8.8.7）：可选字段由 flags 决定
+  BoxReader header(tfhd.data, tfhd.end);
+  uint32_t tf_flags = header.u32() & 0xFFFFFF;
+  uint32_t track_id = header.u32();
+  Mp4Track* track = findTrack(track_id);
+  if (!track || !header.ok()) {
+    return;
+  }
+  TrackDefaults defaults;
+  for (const auto& trex : defaults_) {
+    if (trex.first == track_id) {
+      defaults = trex.second;
+    }
+  }
+  // 没有 base_data_offset 时以 moof 的起点为基准（default-base-is-moof 或只有一个 traf）
+  uint64_t base = offsetOf(moof.begin);
+  if (tf_flags & 0x01) {
+    base = header.u64();
+  }
+  if (tf_flags & 0x02) {
+    header.skip(4);  // sample_description_index
+  }
+  if (tf_flags & 0x08) {
+    defaults.duration = header.u32();
+  }
+  if (tf_flags & 0x10) {
+    defaults.size = header.u32();
+  }
+  if (tf_flags & 0x20) {
+    defaults.flags = header.u32();
+  }
+  if (!header.ok()) {
+    return;
+  }
+
+  size_t index = track - tracks_.data();
+  int64_t dts = next_dts_[index];
+  Box tfdt;
+  if (findBox(traf.data, traf.end, fourcc("tfdt"), tfdt)) {
+    BoxReader reader(tfdt.data, tfdt.end);
+    uint8_t version = reader.u8();
+    reader.skip(3);
+    uint64_t decode_time = version == 1 ? reader.u64() : reader.u32();
+    if (reader.ok()) {
+      dts = static_cast<int64_t>(decode_time);
+    }
+  }
+
+  // 一个 traf 可以有多个 trun，没有 data_offset 的接在上一个之后
+  uint64_t data_offset = base;
+  Box trun;
+  const uint8_t* p = traf.data;
+  while (nextBox(p, traf.end, trun)) {
+    if (trun.type != fourcc("trun")) {
+      continue;
+    }
+    BoxReader reader(trun.data, trun.end);
+    reader.skip(1);  // version
+    uint32_t flags = reader.u24();
+    uint32_t count = reader.u32();
+    if (flags & 0x01) {
+      data_offset = base + static_cast<int32_t>(reader.u32());
+    }
+    uint32_t first_flags = defaults.flags;
+    bool has_first_flags = flags & 0x04;
+    if (has_first_flags) {
+      first_flags = reader.u32();
+    }
+    size_t per_sample = ((flags & 0x100) ? 4 : 0) + ((flags & 0x200) ? 4 : 0) +
+                        ((flags & 0x400) ? 4 : 0) + ((flags & 0x800) ? 4 : 0);
+    if (!reader.ok() || uint64_t(count) * per_sample > reader.remaining()) {
+      return;
+    }
+    for (uint32_t i = 0; i < count; ++i) {
+      Mp4Sample sample;
+      uint32_t duration =
+          (flags & 0x100) ? reader.u32() : defaults.duration;
+      sample.size = (flags & 0x200) ? reader.u32() : defaults.size;
+      uint32_t sample_flags = (flags & 0x400) ? reader.u32()
+                              : (i == 0 && has_first_flags) ? first_flags
+                                                            : defaults.flags;
+      if (flags & 0x800) {
+        // version 0 为无符号数，实际的偏移都远小于 2^31，按有符号处理即可
+        sample.cts = static_cast<int32_t>(reader.u32());
+      }
+      sample.offset = data_offset;
+      sample.dts = dts;
+      // 音频样本都可以独立解码
+      sample.sync = track->type == MediaType::AUDIO ||
+                    !(sample_flags & kNonSyncFlag);
+      if (sample.offset > size_ || sample.size > size_ - sample.offset) {
+        return;
+      }
+      track->samples.push_back(sample);
+      data_offset += sample.size;
+      dts += duration;
+    }
+    next_dts_[index] = dts;
+  }
+}
+}  // namespace
+
+bool isMp4Path(const std::string& path) {
+  size_t dot = path.rfind('.');
+  if (dot == std::string::npos) {
+    return false;
+  }
+  std::string_view ext = std::string_view(path).substr(dot);
+  return Utils::iequals(ext, ".mp4") || Utils::iequals(ext, ".m4v") ||
+         Utils::iequals(ext, ".mov");
+}
+
+bool parseMp4(const uint8_t* data, size_t size, std::vector<Mp4Track>& tracks) {
+  Mp4Parser parser(data, size);
+  return parser.parse(tracks);
+}
@@ -0,0 +1,46 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "global.h"
+
+// 文件中的一段数据，偏移相对于文件开头
+struct Mp4Range {
+  uint64_t offset = 0;
+  uint32_t size = 0;
+};
+
+// 一个样本（视频的一帧或音频的一个 AU），时间单位为轨道的 timescale
+struct Mp4Sample {
+  uint64_t offset = 0;
+  uint32_t size = 0;
+  int64_t dts = 0;
+  int32_t cts = 0;  // 显示时间 - 解码时间，有 B 帧时不为 0
+  bool sync = true;
+};
+
+// ISO-BMFF 的一条轨道，只记录位置，不拷贝样本数据
+struct Mp4Track {
+  uint32_t track_id = 0;
+  MediaType type = MediaType::NONE;
+  CodecId codec = CodecId::H264;
+  uint32_t timescale = 0;
+  // 视频：样本是带长度前缀的 NALU（AVCC/HVCC），参数集在 avcC/hvcC 里
+  uint8_t nal_length_size = 4;
+  std::vector<Mp4Range> parameter_sets;
+  // 音频：mp4a 的采样率、声道数和 AudioSpecificConfig（esds 中的 DecSpecificInfo）
+  uint32_t sample_rate = 0;
+  uint32_t channels = 0;
+  Mp4Range audio_config;
+  std::vector<Mp4Sample> samples;
+};
+
+// .mp4/.m4v/.mov 按 ISO-BMFF 解析
+bool isMp4Path(const std::string& path);
+
+// 解析 [data, data + size) 的 moov 样本表（stbl），以及分片文件的 moof/trun，
+// 样本按解码顺序排列；只保留能处理的编码（H.264/H.265/AAC）的轨道
+// 文件结构不对时返回 false
+bool parseMp4(const uint8_t* data, size_t size, std::vector<Mp4Track>& tracks);
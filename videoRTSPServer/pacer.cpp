@@ -0,0 +1,201 @@
+#include "pacer.h"
+
+#include <algorithm>
+#include <iostream>
+
+FramePacer makeVideoPacer(const MediaSource& source, int fps) {
+  if (source.hasTiming()) {
+    return FramePacer(90000, 90000 / fps);
+  }
+  return FramePacer(fps);
+}
+
+uint32_t advanceVideoPacer(FramePacer& pacer, const MediaSource& source,
+                           size_t unit) {
+  uint32_t timestamp = pacer.rtpTimestamp(90000);
+  if (!source.hasTiming()) {
+    pacer.advance();
+    return timestamp;
+  }
+  const UnitTiming& timing = source.unitTiming(unit);
+  pacer.advance(timing.duration);
+  return timestamp + static_cast<uint32_t>(timing.cts);
+}
+
+net::execution_context::id TimerWheel::id;
+constexpr std::chrono::microseconds TimerWheel::kTick;
+
+TimerWheel::TimerWheel(net::execution_context& context)
+    : net::execution_context::service(context),
+      slots_(kSlots),
+      timer_(static_cast<net::io_context&>(context)) {}
+
+void TimerWheel::shutdown() {
+  timer_.cancel();
+  for (auto& slot : slots_) {
+    slot.clear();
+  }
+  pending_ = 0;
+}
+
+void TimerWheel::schedule(PacketPacer* pacer, Clock::time_point when) {
+  if (pacer->scheduled_) {
+    cancel(pacer);
+  }
+  if (pending_ == 0 && !armed_) {
+    // 空闲后重新对齐到当前时刻
+    current_time_ = Clock::now();
+  }
+  // 至少放到下一格，最远放到最后一格
+  auto delay = when - current_time_;
+  size_t ticks = delay <= Clock::duration::zero()
+                     ? 1
+                     : static_cast<size_t>((delay + kTick - Clock::duration(1)) /
+                                           kTick);
+  ticks = std::min(std::max<size_t>(ticks, 1), kSlots - 1);
+  size_t slot = (current_slot_ + ticks) % kSlots;
+  slots_[slot].push_back(pacer);
+  pacer->scheduled_ = true;
+  pacer->slot_ = slot;
+  ++pending_;
+  if (!armed_) {
+    arm();
+  }
+}
+
+void TimerWheel::cancel(PacketPacer* pacer) {
+  if (!pacer->scheduled_) {
+    return;
+  }
+  auto& slot = slots_[pacer->slot_];
+  auto it = std::find(slot.begin(), slot.end(), pacer);
+  if (it != slot.end()) {
+    *it = slot.back();
+    slot.pop_back();
+    --pending_;
+  }
+  pacer->scheduled_ = false;
+}
+
+void TimerWheel::arm() {
+  armed_ = true;
+  timer_.expires_at(current_time_ + kTick);
+  timer_.async_wait([this](boost::system::error_code ec) {
+    armed_ = false;
+    if (!ec) {
+      onTick();
+    }
+  });
+}
+
+void TimerWheel::onTick() {
+  auto now = Clock::now();
+  // 线程被长时间占用时最多转一圈，剩下的时间直接跳过
+  size_t steps = 0;
+  while (current_time_ + kTick <= now && pending_ > 0) {
+    current_time_ += kTick;
+    current_slot_ = (current_slot_ + 1) % kSlots;
+    if (++steps >= kSlots) {
+      current_time_ = now;
+    }
+    // 回调里可能重新安排，先换出来再逐个触发
+    firing_.swap(slots_[current_slot_]);
+    pending_ -= firing_.size();
+    for (PacketPacer* pacer : firing_) {
+      pacer->scheduled_ = false;
+    }
+    for (PacketPacer* pacer : firing_) {
+      pacer->onTimer(now);
+    }
+    firing_.clear();
+  }
+  if (pending_ > 0) {
+    arm();
+  }
+}
+
+PacketPacer::PacketPacer(TimerWheel& wheel, UDPBatchSender& sender,
+                         const udp::endpoint& to, uint64_t peak_rate_bps,
+                         size_t burst_bytes)
+    : wheel_(wheel),
+      sender_(sender),
+      to_(to),
+      peak_rate_(peak_rate_bps / 8.0),
+      rate_(peak_rate_),
+      // 桶至少要能装下一个完整的包
+      burst_(static_cast<double>(std::max<size_t>(burst_bytes, 1500))),
+      tokens_(burst_),
+      last_refill_(TimerWheel::Clock::now()) {}
+
+PacketPacer::~PacketPacer() { wheel_.cancel(this); }
+
+void PacketPacer::enqueue(const std::vector<RTPPacket>& packets,
+                          std::chrono::nanoseconds interval,
+                          std::shared_ptr<const void> owner) {
+  auto now = TimerWheel::Clock::now();
+  refill(now);
+  // 已发送的部分超过一半时整理一次，稳定后不再分配
+  if (head_ > 0 && head_ * 2 >= queue_.size()) {
+    queue_.erase(queue_.begin(), queue_.begin() + head_);
+    head_ = 0;
+  }
+  if (owners_.empty() || owners_.back() != owner) {
+    owners_.push_back(std::move(owner));
+  }
+  for (const RTPPacket& packet : packets) {
+    queue_.push_back(packet);
+    queued_bytes_ += packet.size();
+  }
+  // 积压超过峰值速率下一秒的量，说明峰值设得比码率还低，直接发出去避免无限堆积
+  if (queued_bytes_ > peak_rate_) {
+    std::cerr << "pacer backlog " << queued_bytes_ << " bytes, flush"
+              << std::endl;
+    sender_.send(queue_.data() + head_, queue_.size() - head_, to_);
+    queue_.clear();
+    head_ = 0;
+    queued_bytes_ = 0;
+    owners_.clear();
+    wheel_.cancel(this);
+    return;
+  }
+  // 速率按在一个帧间隔内发完积压的量计算，但不超过峰值
+  double seconds = std::chrono::duration<double>(interval).count();
+  rate_ = std::min(peak_rate_, queued_bytes_ / std::max(seconds, 1e-3));
+  drain(now);
+}
+
+void PacketPacer::onTimer(TimerWheel::Clock::time_point now) {
+  refill(now);
+  drain(now);
+}
+
+void PacketPacer::refill(TimerWheel::Clock::time_point now) {
+  double elapsed = std::chrono::duration<double>(now - last_refill_).count();
+  tokens_ = std::min(burst_, tokens_ + elapsed * rate_);
+  last_refill_ = now;
+}
+
+void PacketPacer::drain(TimerWheel::Clock::time_point now) {
+  size_t count = 0;
+  while (head_ + count < queue_.size() &&
+         tokens_ >= queue_[head_ + count].size()) {
+    tokens_ -= queue_[head_ + count].size();
+    queued_bytes_ -= queue_[head_ + count].size();
+    ++count;
+  }
+  if (count > 0) {
+    sender_.send(queue_.data() + head_, count, to_);
+    head_ += count;
+  }
+  if (head_ == queue_.size()) {
+    queue_.clear();
+    head_ = 0;
+    owners_.clear();
+    return;
+  }
+  // 等攒够下一个包需要的令牌
+  double need = queue_[head_].size() - tokens_;
+  auto wait = std::chrono::duration<double>(need / std::max(rate_, 1.0));
+  wheel_.schedule(
+      this, now + std::chrono::duration_cast<TimerWheel::Clock::duration>(wait));
+}
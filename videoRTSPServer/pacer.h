@@ -0,0 +1,131 @@
+#pragma once
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "RTP.h"
+#include "global.h"
+#include "rtpsender.h"
+
+// 帧级节拍：第 n 帧的发送时刻按起点 + n / 帧率计算，配合 expires_at 使用，
+// 不会像 expires_after 链式调用那样累积误差；RTP 时间戳同样由帧位置推算
+// 位置以 1/rate 秒为单位，默认每帧前进 scale：视频为 fps / 1，
+// 音频为采样率 / 每帧采样数（如 AAC 44100 / 1024），MP4 为 90000 / 每帧的实际时长
+class FramePacer {
+ public:
+  using Clock = std::chrono::steady_clock;
+
+  explicit FramePacer(int fps = 60) : rate_(fps), scale_(1) {}
+  FramePacer(uint32_t rate, uint32_t scale) : rate_(rate), scale_(scale) {}
+  // 以 now 为起点重新计时，帧位置（即 RTP 时间戳）保持连续
+  void reset(Clock::time_point now) {
+    epoch_ = now;
+    epoch_position_ = position_;
+  }
+  // 当前帧应该发送的时刻
+  Clock::time_point deadline() const {
+    // 先除后乘，长时间运行也不会溢出
+    uint64_t ticks = position_ - epoch_position_;
+    uint64_t elapsed =
+        ticks / rate_ * 1000000000ull + ticks % rate_ * 1000000000ull / rate_;
+    return epoch_ + std::chrono::nanoseconds(elapsed);
+  }
+  // 当前帧的 RTP 时间戳，clock_rate 为媒体时钟频率（视频 90000，音频为采样率）
+  uint32_t rtpTimestamp(uint32_t clock_rate) const {
+    return static_cast<uint32_t>(position_ * clock_rate / rate_);
+  }
+  // 一帧的时长
+  std::chrono::nanoseconds frameDuration() const {
+    return std::chrono::nanoseconds(1000000000ull * scale_ / rate_);
+  }
+  void advance() { position_ += scale_; }
+  // 帧长不固定时（MP4 的样本时长）按实际时长前进
+  void advance(uint64_t ticks) { position_ += ticks; }
+
+ private:
+  uint64_t rate_;
+  uint64_t scale_;
+  uint64_t position_ = 0;
+  uint64_t epoch_position_ = 0;
+  Clock::time_point epoch_;
+};
+
+// 视频的帧节拍：带时间戳的容器（MP4）以 90kHz 为单位按每帧的实际时长前进，
+// 裸码流按固定帧率
+FramePacer makeVideoPacer(const MediaSource& source, int fps);
+// 返回 unit 这一帧的 RTP 时间戳（90kHz）并把节拍推进到下一帧
+// 包按解码顺序发送，有 B 帧时时间戳为显示时间，不单调
+uint32_t advanceVideoPacer(FramePacer& pacer, const MediaSource& source,
+                           size_t unit);
+
+class PacketPacer;
+
+// 每个 io_context 一个的时间轮，驱动该线程上所有会话的 PacketPacer
+// 只用一个定时器，不会每个包、每个会话都挂一个定时器；只在所属 io_context 线程上使用
+class TimerWheel : public net::execution_context::service {
+ public:
+  using Clock = std::chrono::steady_clock;
+  static net::execution_context::id id;
+
+  explicit TimerWheel(net::execution_context& context);
+  // when 时刻回调 pacer->onTimer，已有的安排会被替换
+  void schedule(PacketPacer* pacer, Clock::time_point when);
+  void cancel(PacketPacer* pacer);
+
+ private:
+  void shutdown() override;
+  void arm();
+  void onTick();
+
+  static constexpr std::chrono::microseconds kTick{500};
+  static constexpr size_t kSlots = 512;  // 时间轮跨度 256ms，更远的放到最后一格
+  std::vector<std::vector<PacketPacer*>> slots_;
+  std::vector<PacketPacer*> firing_;
+  size_t current_slot_ = 0;
+  Clock::time_point current_time_;  // current_slot_ 对应的时刻
+  size_t pending_ = 0;
+  bool armed_ = false;
+  net::steady_timer timer_;
+};
+
+// 令牌桶平滑发送：把一帧的包均匀分散到帧间隔内，速率不超过 peak，
+// 瞬时突发不超过 burst，避免大 IDR 帧的几百个包同时涌向接收端
+class PacketPacer {
+ public:
+  PacketPacer(TimerWheel& wheel, UDPBatchSender& sender,
+              const udp::endpoint& to, uint64_t peak_rate_bps,
+              size_t burst_bytes);
+  ~PacketPacer();
+  PacketPacer(const PacketPacer&) = delete;
+  PacketPacer& operator=(const PacketPacer&) = delete;
+
+  // 放入一帧的包，计划在 interval 内发完
+  // 包的负载只是指针，owner 是负载所在内存的持有者，发完之前一直持有
+  void enqueue(const std::vector<RTPPacket>& packets,
+               std::chrono::nanoseconds interval,
+               std::shared_ptr<const void> owner);
+  size_t queuedBytes() const { return queued_bytes_; }
+
+ private:
+  friend class TimerWheel;
+  void onTimer(TimerWheel::Clock::time_point now);
+  void refill(TimerWheel::Clock::time_point now);
+  void drain(TimerWheel::Clock::time_point now);
+
+  TimerWheel& wheel_;
+  UDPBatchSender& sender_;
+  udp::endpoint to_;
+  double peak_rate_;  // 字节/秒
+  double rate_;       // 当前补充令牌的速率
+  double burst_;
+  double tokens_;
+  TimerWheel::Clock::time_point last_refill_;
+  std::vector<RTPPacket> queue_;  // [head_, end) 为待发送
+  size_t head_ = 0;
+  size_t queued_bytes_ = 0;
+  std::vector<std::shared_ptr<const void>> owners_;
+  // 由 TimerWheel 维护
+  bool scheduled_ = false;
+  size_t slot_ = 0;
+};
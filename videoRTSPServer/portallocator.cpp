@@ -0,0 +1,63 @@
+#include "portallocator.h"
+
+#include <algorithm>
+#include <iostream>
+
+#include "config.h"
+
+PortAllocator::PortAllocator() {
+  auto config = ServerConfig::GetInstance();
+  // RTP 端口必须是偶数，配置加载时已保证 rtp_port_min <= 65534，不会溢出
+  min_port_ = (config->rtp_port_min + 1) & ~1;
+  max_port_ = config->rtp_port_max;
+  for (uint32_t port = min_port_; port + 1 <= max_port_; port += 2) {
+    free_ports_.push_back(static_cast<uint16_t>(port));
+  }
+  in_use_.resize(free_ports_.size(), false);
+  // 倒序入栈，先分配小端口
+  std::reverse(free_ports_.begin(), free_ports_.end());
+}
+
+uint16_t PortAllocator::allocate() {
+  std::lock_guard<std::mutex> lock(mtx_);
+  if (free_ports_.empty()) {
+    std::cerr << "no free RTP port" << std::endl;
+    return 0;
+  }
+  uint16_t port = free_ports_.back();
+  free_ports_.pop_back();
+  in_use_[(port - min_port_) / 2] = true;
+  return port;
+}
+
+void PortAllocator::release(uint16_t rtp_port) {
+  std::lock_guard<std::mutex> lock(mtx_);
+  if (markFree(rtp_port)) {
+    free_ports_.push_back(rtp_port);
+  }
+}
+
+void PortAllocator::releaseBusy(uint16_t rtp_port) {
+  std::lock_guard<std::mutex> lock(mtx_);
+  if (markFree(rtp_port)) {
+    free_ports_.push_front(rtp_port);
+  }
+}
+
+bool PortAllocator::markFree(uint16_t rtp_port) {
+  if (rtp_port < min_port_ || rtp_port + 1 > max_port_ ||
+      (rtp_port - min_port_) % 2 != 0) {
+    return false;
+  }
+  size_t index = (rtp_port - min_port_) / 2;
+  if (!in_use_[index]) {
+    return false;
+  }
+  in_use_[index] = false;
+  return true;
+}
+
+size_t PortAllocator::available() {
+  std::lock_guard<std::mutex> lock(mtx_);
+  return free_ports_.size();
+}
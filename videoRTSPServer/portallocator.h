@@ -0,0 +1,33 @@
+#pragma once
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <vector>
+
+#include "singleton.h"
+
+// 服务器端 RTP/RTCP 端口分配：从配置的范围中按 偶数/奇数 成对分配，
+// 空闲的端口对放在一个栈里，分配和释放都是 O(1)，多个 io_context 线程共用；
+// 绑定失败（被其他进程占用）的端口对放到栈底，最后才会再分到
+class PortAllocator : public Singleton<PortAllocator> {
+  friend class Singleton<PortAllocator>;
+
+ public:
+  // 返回 RTP 端口（偶数），RTCP 端口为其 + 1；没有空闲端口时返回 0
+  uint16_t allocate();
+  void release(uint16_t rtp_port);
+  // 绑定失败时归还，放到栈底，下一次 allocate 换一对端口
+  void releaseBusy(uint16_t rtp_port);
+  size_t available();
+
+ private:
+  PortAllocator();
+  // 把端口标记为空闲，重复释放或不在范围内时返回 false
+  bool markFree(uint16_t rtp_port);
+
+  std::mutex mtx_;
+  uint16_t min_port_;
+  uint16_t max_port_;
+  std::deque<uint16_t> free_ports_;  // 空闲的 RTP 端口，back 为栈顶
+  std::vector<bool> in_use_;         // 防止重复释放
+};
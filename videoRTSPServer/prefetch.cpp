@@ -0,0 +1,140 @@
+#include "prefetch.h"
+
+#include <algorithm>
+
+#include "threadpool.h"
+
+namespace {
+constexpr size_t kPageSize = 4096;
+// 读到的字节写到这里，不让编译器把读取优化掉
+volatile uint8_t g_touch_sink;
+
+// 每页读一个字节，冷数据的缺页（读盘）发生在工作线程而不是网络线程
+void touchPages(const PrefetchedFrame& frame) {
+  uint8_t sum = 0;
+  for (const NaluView& nalu : frame.nalus) {
+    if (nalu.size == 0) {
+      continue;
+    }
+    for (size_t offset = 0; offset < nalu.size; offset += kPageSize) {
+      sum += nalu.data[offset];
+    }
+    sum += nalu.data[nalu.size - 1];
+  }
+  g_touch_sink = sum;
+}
+}  // namespace
+
+FramePrefetcher::FramePrefetcher(ReadFn read,
+                                 std::chrono::nanoseconds frame_interval)
+    : read_(std::move(read)),
+      frame_interval_ns_(std::max<uint64_t>(frame_interval.count(), 1)),
+      ring_(kMaxDepth) {}
+
+void FramePrefetcher::start(const net::any_io_executor& executor,
+                            std::function<void()> on_ready) {
+  executor_ = executor;
+  on_ready_ = std::move(on_ready);
+  schedule();
+}
+
+void FramePrefetcher::stop() { stopped_.store(true, std::memory_order_release); }
+
+PrefetchedFrame* FramePrefetcher::front() { return ring_.front(); }
+
+void FramePrefetcher::pop() {
+  ring_.pop();
+  // 低于一半时再提交预读任务，一次补满，不必每帧提交一次
+  if (ring_.size() <= depth() / 2) {
+    schedule();
+  }
+}
+
+bool FramePrefetcher::finished() const {
+  return eof_.load(std::memory_order_acquire) && ring_.size() == 0;
+}
+
+bool FramePrefetcher::waitReady() {
+  // 读得比播放慢，加大预读深度
+  depth_.store(std::min(kMaxDepth, depth() * 2), std::memory_order_relaxed);
+  schedule();
+  // 先登记再检查，与 notifyReady 中先放入再读 waiting_ 配对，不会漏掉通知
+  waiting_.store(true, std::memory_order_seq_cst);
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+  if (ring_.size() == 0 && !eof_.load(std::memory_order_acquire)) {
+    return true;
+  }
+  // 登记期间已经读好：通知还没发出就自己撤销；已经发出则等它
+  return !waiting_.exchange(false);
+}
+
+void FramePrefetcher::schedule() {
+  if (stopped_.load(std::memory_order_acquire) ||
+      eof_.load(std::memory_order_acquire) ||
+      scheduled_.exchange(true, std::memory_order_acq_rel)) {
+    return;
+  }
+  ThreadPool::GetInstance()->post(
+      [self = shared_from_this()]() { self->fill(); });
+}
+
+void FramePrefetcher::fill() {
+  while (true) {
+    size_t want = kMinDepth;
+    while (!stopped_.load(std::memory_order_acquire) &&
+           ring_.size() < depth()) {
+      PrefetchedFrame* frame = ring_.writeSlot();
+      if (frame == nullptr) {
+        break;
+      }
+      auto begin = std::chrono::steady_clock::now();
+      frame->nalus.clear();
+      if (!read_(*frame)) {
+        eof_.store(true, std::memory_order_release);
+        notifyReady();
+        break;
+      }
+      touchPages(*frame);
+      uint64_t ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                        std::chrono::steady_clock::now() - begin)
+                        .count();
+      read_ns_ = (read_ns_ * 7 + ns) / 8;
+      // 读一帧要几个帧间隔，就多提前几帧，留一倍余量
+      want = std::min(
+          kMaxDepth,
+          kMinDepth + (2 * read_ns_ + frame_interval_ns_ - 1) /
+                          frame_interval_ns_);
+      if (want > depth()) {
+        depth_.store(want, std::memory_order_relaxed);
+      }
+      ring_.push();
+      notifyReady();
+    }
+    // 读得快时深度每批回落一帧
+    size_t depth = this->depth();
+    if (want < depth && !eof_.load(std::memory_order_relaxed)) {
+      depth_.store(depth - 1, std::memory_order_relaxed);
+    }
+    scheduled_.store(false, std::memory_order_seq_cst);
+    // 清标志之前网络线程可能取走了帧却没能提交，这里再检查一次
+    if (stopped_.load(std::memory_order_acquire) ||
+        eof_.load(std::memory_order_acquire) ||
+        ring_.size() > this->depth() / 2 ||
+        scheduled_.exchange(true, std::memory_order_acq_rel)) {
+      return;
+    }
+  }
+}
+
+void FramePrefetcher::notifyReady() {
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+  if (!waiting_.load(std::memory_order_relaxed) ||
+      !waiting_.exchange(false)) {
+    return;
+  }
+  net::post(executor_, [self = shared_from_this()]() {
+    if (!self->stopped_.load(std::memory_order_relaxed)) {
+      self->on_ready_();
+    }
+  });
+}
@@ -0,0 +1,113 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <vector>
+
+#include "global.h"
+#include "mediafile.h"
+
+// 预读好的一帧（视频的访问单元或音频的一个 AU）：NALU 视图已经切好，
+// 所在的页已经读入内存，网络线程打包发送时不会再因缺页等磁盘
+struct PrefetchedFrame {
+  size_t index = 0;  // 帧在文件中的序号
+  bool is_key = false;
+  std::vector<NaluView> nalus;
+};
+
+// 单生产者单消费者的有界环，槽位循环复用，其中的 vector 稳定后不再分配
+template <typename T>
+class SPSCRing {
+ public:
+  explicit SPSCRing(size_t capacity) : slots_(capacity + 1) {}
+  size_t capacity() const { return slots_.size() - 1; }
+  size_t size() const {
+    size_t head = head_.load(std::memory_order_acquire);
+    size_t tail = tail_.load(std::memory_order_acquire);
+    return tail >= head ? tail - head : tail + slots_.size() - head;
+  }
+  // 生产者：下一个可写的槽位，满了返回 nullptr，写好后调用 push()
+  T* writeSlot() {
+    size_t tail = tail_.load(std::memory_order_relaxed);
+    if (next(tail) == head_.load(std::memory_order_acquire)) {
+      return nullptr;
+    }
+    return &slots_[tail];
+  }
+  void push() {
+    size_t tail = tail_.load(std::memory_order_relaxed);
+    tail_.store(next(tail), std::memory_order_release);
+  }
+  // 消费者：队首，空时返回 nullptr，用完后调用 pop()
+  T* front() {
+    size_t head = head_.load(std::memory_order_relaxed);
+    if (head == tail_.load(std::memory_order_acquire)) {
+      return nullptr;
+    }
+    return &slots_[head];
+  }
+  void pop() {
+    size_t head = head_.load(std::memory_order_relaxed);
+    head_.store(next(head), std::memory_order_release);
+  }
+
+ private:
+  size_t next(size_t pos) const { return pos + 1 == slots_.size() ? 0 : pos + 1; }
+
+  std::vector<T> slots_;
+  alignas(64) std::atomic<size_t> head_{0};
+  alignas(64) std::atomic<size_t> tail_{0};
+};
+
+// 会话的一路媒体的预读：线程池的任务提前读取、切分后面若干帧放进环里，
+// 网络线程只取已经读好的帧；同一时刻最多一个预读任务，环中帧数低于一半时再提交
+// 预读深度随读一帧的耗时自适应：耗时相当于几个帧间隔就多读几帧，网络线程等过帧就加倍
+class FramePrefetcher : public std::enable_shared_from_this<FramePrefetcher> {
+ public:
+  // 在工作线程中调用，把下一帧读到 frame 中（nalus 需先清空），没有更多帧时返回 false
+  using ReadFn = std::function<bool(PrefetchedFrame& frame)>;
+  static constexpr size_t kMinDepth = 2;
+  static constexpr size_t kMaxDepth = 64;
+
+  // frame_interval 为两帧之间的播放间隔，用来把读取耗时换算成需要提前的帧数
+  FramePrefetcher(ReadFn read, std::chrono::nanoseconds frame_interval);
+  FramePrefetcher(const FramePrefetcher&) = delete;
+  FramePrefetcher& operator=(const FramePrefetcher&) = delete;
+
+  // 开始预读；on_ready 在 executor 上调用，表示 waitReady() 等的帧读好了或已读完
+  void start(const net::any_io_executor& executor,
+             std::function<void()> on_ready);
+  // 停止后不再读取，也不再调用 on_ready；正在执行的预读任务读完当前帧就退出
+  void stop();
+
+  // 以下在网络线程调用
+  // 已经读好的下一帧，没有时返回 nullptr
+  PrefetchedFrame* front();
+  void pop();
+  // 读到了结尾，且读好的帧都已取走
+  bool finished() const;
+  // front() 为空且未结束时调用，返回 true 表示帧读好后会调用 on_ready；
+  // 返回 false 表示登记期间已经读好（或读完），直接重试即可
+  bool waitReady();
+  size_t depth() const { return depth_.load(std::memory_order_relaxed); }
+
+ private:
+  void schedule();
+  // 预读任务：一直读到环中有 depth_ 帧、读完或停止
+  void fill();
+  void notifyReady();
+
+  ReadFn read_;
+  const uint64_t frame_interval_ns_;
+  SPSCRing<PrefetchedFrame> ring_;
+  net::any_io_executor executor_;
+  std::function<void()> on_ready_;
+  std::atomic<size_t> depth_{kMinDepth};
+  std::atomic<bool> scheduled_{false};  // 已有预读任务在队列中或正在执行
+  std::atomic<bool> waiting_{false};    // 网络线程在等下一帧
+  std::atomic<bool> eof_{false};
+  std::atomic<bool> stopped_{false};
+  uint64_t read_ns_ = 0;  // 读一帧耗时的滑动平均，只在预读任务中访问
+};
@@ -0,0 +1,31 @@
+#include "retransmit.h"
+
+#include <algorithm>
+
+RetransmitBuffer::RetransmitBuffer(size_t capacity) {
+  size_t size = 1;
+  while (size < std::min<size_t>(capacity, 32768)) {
+    size <<= 1;
+  }
+  slots_.resize(size);
+  mask_ = size - 1;
+}
+
+void RetransmitBuffer::store(const RTPPacket* packets, size_t count) {
+  for (size_t i = 0; i < count; ++i) {
+    slots_[packets[i].seq() & mask_] = packets[i];
+  }
+}
+
+const RTPPacket* RetransmitBuffer::find(uint16_t seq) const {
+  const RTPPacket& packet = slots_[seq & mask_];
+  // 空槽位 size() 为 0
+  if (packet.size() == 0 || packet.seq() != seq) {
+    return nullptr;
+  }
+  return &packet;
+}
+
+void RetransmitBuffer::clear() {
+  std::fill(slots_.begin(), slots_.end(), RTPPacket());
+}
@@ -0,0 +1,24 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "RTP.h"
+
+// 最近发出的 RTP 包的环形缓冲区，按序号低位直接定位，收到 NACK 时从这里重发
+// 槽位在构造时一次分配好，记录和查找都只拷贝包头和负载指针，不再分配内存
+// 负载仍指向原来的内存，调用者需保证在 clear() 之前这块内存有效
+class RetransmitBuffer {
+ public:
+  // 容量向上取整到 2 的幂，最大 32768，保证环内不会有两个包序号相同
+  explicit RetransmitBuffer(size_t capacity);
+  void store(const RTPPacket* packets, size_t count);
+  // 找不到（已被覆盖或从未发出）返回 nullptr
+  const RTPPacket* find(uint16_t seq) const;
+  void clear();
+  size_t capacity() const { return slots_.size(); }
+
+ private:
+  std::vector<RTPPacket> slots_;
+  size_t mask_;
+};
@@ -0,0 +1,140 @@
+#include "rtpbatchpool.h"
+
+#include <cstddef>
+#include <new>
+
+#include "metrics.h"
+
+net::execution_context::id RTPBatchPool::id;
+
+namespace {
+// 足够放下 libstdc++/libc++ 带删除器和分配器的控制块
+constexpr size_t kControlBlockSize = 64;
+}  // namespace
+
+struct RTPBatchPool::Core {
+  std::atomic<Node*> returned{nullptr};  // 其他线程归还的节点
+  std::atomic<bool> closed{false};       // 池已销毁，归还的节点直接释放
+};
+
+struct RTPBatchPool::Node {
+  RTPBatch batch;
+  alignas(std::max_align_t) unsigned char control_block[kControlBlockSize];
+  Node* next = nullptr;
+  std::shared_ptr<Core> core;
+};
+
+// 最后一个 shared_ptr 释放时只清空内容，节点等控制块销毁后再归还
+struct RTPBatchPool::Recycler {
+  void operator()(RTPBatch* batch) const {
+    batch->source.reset();
+    batch->packets.clear();
+    batch->is_key = false;
+  }
+};
+
+// 控制块直接放在节点里；deallocate 是控制块销毁时最后一步，此时才能归还节点
+template <typename T>
+class RTPBatchPool::NodeAllocator {
+ public:
+  using value_type = T;
+
+  explicit NodeAllocator(Node* node) : node_(node) {}
+  template <typename U>
+  NodeAllocator(const NodeAllocator<U>& other) : node_(other.node_) {}
+
+  T* allocate(size_t n) {
+    static_assert(sizeof(T) <= kControlBlockSize &&
+                      alignof(T) <= alignof(std::max_align_t),
+                  "control block does not fit into the pool node");
+    // 节点里只放得下一个控制块，其他请求（标准库不会有）走普通的堆分配
+    if (n != 1) {
+      return static_cast<T*>(::operator new(n * sizeof(T)));
+    }
+    return reinterpret_cast<T*>(node_->control_block);
+  }
+  void deallocate(T* p, size_t n) {
+    if (n != 1) {
+      ::operator delete(p);
+      return;
+    }
+    RTPBatchPool::recycle(node_);
+  }
+
+  template <typename U>
+  bool operator==(const NodeAllocator<U>& other) const {
+    return node_ == other.node_;
+  }
+  template <typename U>
+  bool operator!=(const NodeAllocator<U>& other) const {
+    return node_ != other.node_;
+  }
+
+ private:
+  template <typename U>
+  friend class NodeAllocator;
+  Node* node_;
+};
+
+RTPBatchPool::RTPBatchPool(net::execution_context& context)
+    : net::execution_context::service(context),
+      core_(std::make_shared<Core>()),
+      metrics_(Metrics::GetInstance()) {}
+
+RTPBatchPool::~RTPBatchPool() {
+  // 还在观看者手里的节点归还时会看到 closed，自行释放
+  core_->closed = true;
+  Node* node = core_->returned.exchange(nullptr, std::memory_order_seq_cst);
+  while (node) {
+    Node* next = node->next;
+    delete node;
+    node = next;
+  }
+  while (local_) {
+    Node* next = local_->next;
+    delete local_;
+    local_ = next;
+  }
+}
+
+std::shared_ptr<RTPBatch> RTPBatchPool::acquire() {
+  if (!local_) {
+    local_ = core_->returned.exchange(nullptr, std::memory_order_acquire);
+  }
+  Node* node = local_;
+  if (node) {
+    local_ = node->next;
+    ++metrics_->batch_pool_reused;
+  } else {
+    node = new Node;
+    node->core = core_;
+    ++metrics_->batch_pool_allocated;
+  }
+  return std::shared_ptr<RTPBatch>(&node->batch, Recycler(),
+                                   NodeAllocator<RTPBatch>(node));
+}
+
+void RTPBatchPool::recycle(Node* node) {
+  // 压栈之后节点可能已被析构函数释放，这里自己持有一份 Core
+  std::shared_ptr<Core> core = node->core;
+  if (core->closed) {
+    delete node;
+    return;
+  }
+  Node* head = core->returned.load(std::memory_order_relaxed);
+  do {
+    node->next = head;
+  } while (!core->returned.compare_exchange_weak(
+      head, node, std::memory_order_seq_cst, std::memory_order_relaxed));
+  // 压栈前池没关，压栈后才关：析构函数可能已经取完了栈，没拿到这个节点，
+  // 再取一次释放掉。压栈与析构函数的 closed/exchange 都是 seq_cst，
+  // 两边至少有一边看到对方
+  if (core->closed) {
+    Node* taken = core->returned.exchange(nullptr, std::memory_order_acquire);
+    while (taken) {
+      Node* next = taken->next;
+      delete taken;
+      taken = next;
+    }
+  }
+}
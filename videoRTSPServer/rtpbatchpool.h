@@ -0,0 +1,45 @@
+#pragma once
+#include <atomic>
+#include <memory>
+#include <vector>
+
+#include "RTP.h"
+#include "global.h"
+#include "mediafile.h"
+
+class Metrics;
+
+// 一次打包的结果，所有观看者共享；负载指向 source 的映射内存，所以一并持有 source
+struct RTPBatch {
+  std::shared_ptr<const MediaSource> source;
+  std::vector<RTPPacket> packets;
+  bool is_key = false;  // IDR 帧（已带 SPS/PPS），新观看者从这里开始接收
+};
+
+// 每个 io_context 一个的 RTPBatch 对象池
+// 对象连同 shared_ptr 的控制块一起放在池节点里，引用计数就在节点内，
+// 最后一个持有者释放时节点回到池中，包数组保留已有容量，稳定后每帧不再分配堆内存
+// acquire 只在所属 io_context 线程上调用；释放可以发生在任意线程（观看者在别的
+// io_context 上），归还走无锁栈，取用时一次性把归还的节点全部接过来，没有 ABA 问题
+class RTPBatchPool : public net::execution_context::service {
+ public:
+  static net::execution_context::id id;
+
+  explicit RTPBatchPool(net::execution_context& context);
+  ~RTPBatchPool() override;
+  std::shared_ptr<RTPBatch> acquire();
+
+ private:
+  struct Core;
+  struct Node;
+  struct Recycler;
+  template <typename T>
+  class NodeAllocator;
+
+  void shutdown() override {}
+  static void recycle(Node* node);
+
+  std::shared_ptr<Core> core_;
+  Node* local_ = nullptr;  // 只在所属线程上访问的空闲节点
+  std::shared_ptr<Metrics> metrics_;
+};
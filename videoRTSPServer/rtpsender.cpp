@@ -0,0 +1,332 @@
+#include "rtpsender.h"
+
+#include <netinet/in.h>
+#include <netinet/udp.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <iostream>
+
+#ifdef USE_IO_URING
+#include "config.h"
+#include "uring.h"
+#endif
+
+#ifndef UDP_SEGMENT
+#define UDP_SEGMENT 103
+#endif
+
+namespace {
+// 内核单个 GSO 报文最多 64 个分段，总长不超过 UDP 报文上限
+constexpr size_t kMaxGsoSegments = 64;
+constexpr size_t kMaxGsoBytes = 65000;
+// sendmmsg 一次最多处理的报文数
+constexpr size_t kMaxBatch = 1024;
+}  // namespace
+
+void UDPBatchSender::setMode(Mode mode) {
+  mode_ = mode;
+  probed_ = mode != Mode::GSO;
+}
+
+void UDPBatchSender::send(const RTPPacket* packets, size_t count,
+                          const udp::endpoint& to,
+                          [[maybe_unused]] std::shared_ptr<const void> owner) {
+  if (count == 0 || !socket_.is_open()) {
+    return;
+  }
+  size_t sent = 0;
+#ifdef __linux__
+  if (!probed_) {
+    probeGso();
+  }
+#ifdef USE_IO_URING
+  // 异步提交要等完成后才释放负载，没有 owner 的（重传、平滑发送）仍然同步发送
+  if (uring_ != nullptr && owner && mode_ != Mode::PLAIN &&
+      uring_->send(socket_.native_handle(), packets, count, to,
+                   mode_ == Mode::GSO, std::move(owner))) {
+    packets_ += count;
+    return;
+  }
+#endif
+  if (mode_ != Mode::PLAIN) {
+    sent = sendBatch(packets, count, to);
+  }
+#else
+  mode_ = Mode::PLAIN;
+#endif
+  // 内核不支持批量发送时，剩下的包逐个发送
+  if (mode_ == Mode::PLAIN && sent < count) {
+    sendPlain(packets + sent, count - sent, to);
+  }
+}
+
+size_t UDPBatchSender::sendPlain(const RTPPacket* packets, size_t count,
+                                 const udp::endpoint& to) {
+  boost::system::error_code ec;
+  for (size_t i = 0; i < count; ++i) {
+    ++syscalls_;
+    socket_.send_to(packets[i].buffers(), to, 0, ec);
+    if (ec) {
+      ++dropped_;
+    } else {
+      ++packets_;
+    }
+  }
+  return count;
+}
+
+void UDPBatchSender::flush() {
+#ifdef USE_IO_URING
+  if (uring_ != nullptr) {
+    uring_->flush();
+  }
+#endif
+}
+
+#ifdef __linux__
+void UDPBatchSender::probeGso() {
+  probed_ = true;
+#ifdef USE_IO_URING
+  if (ServerConfig::GetInstance()->io_uring) {
+    auto& service =
+        net::use_service<UringService>(socket_.get_executor().context());
+    uring_ = service.available() ? &service : nullptr;
+  }
+#endif
+  // 设置 gso_size = 0 不改变任何行为，只用来探测内核是否支持 UDP_SEGMENT
+  int zero = 0;
+  if (setsockopt(socket_.native_handle(), SOL_UDP, UDP_SEGMENT, &zero,
+                 sizeof(zero)) != 0) {
+    std::cerr << "UDP GSO unsupported, use sendmmsg" << std::endl;
+    mode_ = Mode::SENDMMSG;
+  }
+}
+
+void UDPMessages::build(const RTPPacket* packets, size_t count,
+                        const udp::endpoint& to, bool gso) {
+  // 1. 每个包若干 iovec：前缀和负载交替，聚合包有多段负载
+  iovs.clear();
+  iov_first.clear();
+  for (size_t i = 0; i < count; ++i) {
+    iov_first.push_back(iovs.size());
+    for (const auto& buf : packets[i].buffers()) {
+      iovs.push_back({const_cast<void*>(buf.data()), buf.size()});
+    }
+  }
+  iov_first.push_back(iovs.size());
+
+  // 2. 分组：GSO 要求除最后一个分段外长度都相同，连续满足条件的包合成一个报文
+  msgs.clear();
+  msg_first_packet.clear();
+  const size_t control_words = (CMSG_SPACE(sizeof(uint16_t)) + 7) / 8;
+  controls.resize(count * control_words);
+  for (size_t i = 0; i < count;) {
+    size_t seg_size = packets[i].size();
+    size_t total = seg_size;
+    size_t j = i + 1;
+    while (gso && j < count && j - i < kMaxGsoSegments &&
+           packets[j - 1].size() == seg_size &&
+           packets[j].size() <= seg_size &&
+           total + packets[j].size() <= kMaxGsoBytes) {
+      total += packets[j].size();
+      ++j;
+    }
+
+    mmsghdr msg;
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_hdr.msg_name = const_cast<sockaddr*>(to.data());
+    msg.msg_hdr.msg_namelen = to.size();
+    msg.msg_hdr.msg_iov = &iovs[iov_first[i]];
+    msg.msg_hdr.msg_iovlen = iov_first[j] - iov_first[i];
+    if (j - i > 1) {
+      void* control = &controls[msgs.size() * control_words];
+      msg.msg_hdr.msg_control = control;
+      msg.msg_hdr.msg_controllen = CMSG_SPACE(sizeof(uint16_t));
+      cmsghdr* cm = CMSG_FIRSTHDR(&msg.msg_hdr);
+      cm->cmsg_level = SOL_UDP;
+      cm->cmsg_type = UDP_SEGMENT;
+      cm->cmsg_len = CMSG_LEN(sizeof(uint16_t));
+      uint16_t gso_size = static_cast<uint16_t>(seg_size);
+      memcpy(CMSG_DATA(cm), &gso_size, sizeof(gso_size));
+    }
+    msgs.push_back(msg);
+    msg_first_packet.push_back(i);
+    i = j;
+  }
+  msg_first_packet.push_back(count);
+}
+
+size_t UDPBatchSender::sendBatch(const RTPPacket* packets, size_t count,
+                                 const udp::endpoint& to) {
+  bool gso = mode_ == Mode::GSO;
+  messages_.build(packets, count, to, gso);
+  std::vector<mmsghdr>& msgs = messages_.msgs;
+  const std::vector<size_t>& msg_first_packet = messages_.msg_first_packet;
+
+  // 3. 发送，处理部分发送和出错
+  size_t done = 0;
+  while (done < msgs.size()) {
+    size_t batch = std::min(kMaxBatch, msgs.size() - done);
+    ++syscalls_;
+    int ret = sendmmsg(socket_.native_handle(), &msgs[done], batch, 0);
+    if (ret > 0) {
+      packets_ += msg_first_packet[done + ret] - msg_first_packet[done];
+      done += ret;
+      continue;
+    }
+    size_t first = msg_first_packet[done];
+    if (errno == EINTR) {
+      continue;
+    }
+    if (errno == ENOSYS) {
+      std::cerr << "sendmmsg unsupported, send one by one" << std::endl;
+      mode_ = Mode::PLAIN;
+      return first;
+    }
+    if (gso && (errno == EIO || errno == EINVAL || errno == ENOPROTOOPT ||
+                errno == EOPNOTSUPP)) {
+      // 网卡或路由不支持分段卸载，关掉 GSO 后重发剩下的包
+      std::cerr << "UDP GSO failed: " << strerror(errno)
+                << ", use sendmmsg" << std::endl;
+      mode_ = Mode::SENDMMSG;
+      return first + sendBatch(packets + first, count - first, to);
+    }
+    // 其他错误（如缓冲区满）丢掉这个报文，继续发后面的
+    dropped_ += msg_first_packet[done + 1] - first;
+    ++done;
+  }
+  return count;
+}
+#else
+void UDPBatchSender::probeGso() { probed_ = true; }
+
+size_t UDPBatchSender::sendBatch(const RTPPacket* packets, size_t count,
+                                 const udp::endpoint& to) {
+  return 0;
+}
+#endif
+
+std::unique_ptr<TCPInterleavedSender::Item> TCPInterleavedSender::takeItem() {
+  if (free_items_.empty()) {
+    return std::make_unique<Item>();
+  }
+  auto item = std::move(free_items_.back());
+  free_items_.pop_back();
+  return item;
+}
+
+void TCPInterleavedSender::sendText(std::string_view text, bool close_after) {
+  auto item = takeItem();
+  // 拷贝进复用的缓冲区，保留其容量
+  item->text.assign(text);
+  item->bytes = item->text.size();
+  item->close_after = close_after;
+  push(std::move(item));
+}
+
+void TCPInterleavedSender::sendInterleaved(uint8_t channel,
+                                           const uint8_t* data, size_t size) {
+  if (!socket_.is_open() || size > 0xFFFF) {
+    return;
+  }
+  auto item = takeItem();
+  item->text.clear();
+  item->text.push_back('$');
+  item->text.push_back(static_cast<char>(channel));
+  item->text.push_back(static_cast<char>(size >> 8));
+  item->text.push_back(static_cast<char>(size & 0xFF));
+  item->text.append(reinterpret_cast<const char*>(data), size);
+  item->bytes = item->text.size();
+  push(std::move(item));
+}
+
+void TCPInterleavedSender::sendFrame(const std::vector<RTPPacket>& packets,
+                                     uint8_t channel, bool is_key,
+                                     std::shared_ptr<const void> owner) {
+  if (packets.empty() || !socket_.is_open()) {
+    return;
+  }
+  if (waiting_key_ && !is_key) {
+    ++dropped_frames_;
+    return;
+  }
+  size_t bytes = 0;
+  for (const RTPPacket& packet : packets) {
+    bytes += 4 + packet.size();
+  }
+  // 客户端读得太慢，丢掉这一帧，之后的帧也要等到关键帧才能继续
+  if (queued_bytes_ + bytes > max_queue_bytes_) {
+    ++dropped_frames_;
+    waiting_key_ = true;
+    return;
+  }
+  waiting_key_ = false;
+
+  auto item = takeItem();
+  item->packets.assign(packets.begin(), packets.end());
+  item->prefixes.resize(packets.size());
+  for (size_t i = 0; i < packets.size(); ++i) {
+    uint16_t size = static_cast<uint16_t>(packets[i].size());
+    item->prefixes[i] = {'$', channel, static_cast<uint8_t>(size >> 8),
+                         static_cast<uint8_t>(size & 0xFF)};
+  }
+  item->owner = std::move(owner);
+  item->bytes = bytes;
+  push(std::move(item));
+}
+
+void TCPInterleavedSender::push(std::unique_ptr<Item> item) {
+  queued_bytes_ += item->bytes;
+  queue_.push_back(std::move(item));
+  if (!writing_) {
+    writeNext();
+  }
+}
+
+void TCPInterleavedSender::writeNext() {
+  auto owner = owner_.lock();
+  if (queue_.empty() || !owner || !socket_.is_open()) {
+    writing_ = false;
+    return;
+  }
+  writing_ = true;
+  Item& item = *queue_.front();
+  buffers_.clear();
+  if (!item.text.empty()) {
+    buffers_.push_back(boost::asio::buffer(item.text));
+  }
+  for (size_t i = 0; i < item.packets.size(); ++i) {
+    buffers_.push_back(boost::asio::buffer(item.prefixes[i]));
+    for (const auto& buf : item.packets[i].buffers()) {
+      buffers_.push_back(buf);
+    }
+  }
+  boost::asio::async_write(
+      socket_, buffers_,
+      [this, owner](boost::system::error_code ec, std::size_t) {
+        auto item = std::move(queue_.front());
+        queue_.pop_front();
+        queued_bytes_ -= item->bytes;
+        bool close_after = item->close_after;
+        item->text.clear();
+        item->packets.clear();
+        item->owner.reset();
+        item->close_after = false;
+        free_items_.push_back(std::move(item));
+        if (ec || close_after) {
+          // 出错或 TEARDOWN 回复已发出，丢弃剩下的数据
+          boost::system::error_code ignored;
+          socket_.close(ignored);
+          for (auto& rest : queue_) {
+            rest->owner.reset();
+          }
+          queue_.clear();
+          queued_bytes_ = 0;
+          writing_ = false;
+          return;
+        }
+        writeNext();
+      });
+}
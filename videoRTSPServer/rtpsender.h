@@ -0,0 +1,120 @@
+#pragma once
+#include <sys/socket.h>
+
+#include <array>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "RTP.h"
+#include "global.h"
+
+#ifdef __linux__
+// 一批 RTP 包对应的 sendmsg 参数：GSO 时连续等长的包合成一个报文
+// 其中的指针指向 packets 中的包头、负载和 to，它们有效期间才能使用
+struct UDPMessages {
+  std::vector<iovec> iovs;
+  std::vector<size_t> iov_first;         // 每个包的第一个 iovec
+  std::vector<mmsghdr> msgs;
+  std::vector<size_t> msg_first_packet;  // 每个报文的第一个包，末尾为包数
+  std::vector<uint64_t> controls;        // 每个报文的 UDP_SEGMENT cmsg
+  // 复用已有的容量，稳定后不再分配
+  void build(const RTPPacket* packets, size_t count, const udp::endpoint& to,
+             bool gso);
+};
+#endif
+
+class UringService;
+
+// 批量发送 RTP 包：
+// GSO：连续等长的包拼成一个超大 UDP 报文，由内核（或网卡）按 gso_size 切分
+// SENDMMSG：一次 sendmmsg 系统调用发送多个报文，GSO 报文也在其中
+// PLAIN：逐包 send_to，内核不支持上面两种方式时退回到这里
+// 编译时开启 io_uring 且配置启用时，带 owner 的整帧交给所在 io_context 的
+// UringService 异步提交，同一轮事件循环中各会话的报文合并为一次 io_uring_enter
+class UDPBatchSender {
+ public:
+  enum class Mode { GSO, SENDMMSG, PLAIN };
+
+  explicit UDPBatchSender(udp::socket& socket) : socket_(socket) {}
+  // owner 持有包负载所在的内存；为空时同步发送，返回时内核已拷贝完数据
+  void send(const std::vector<RTPPacket>& packets, const udp::endpoint& to,
+            std::shared_ptr<const void> owner = nullptr) {
+    send(packets.data(), packets.size(), to, std::move(owner));
+  }
+  void send(const RTPPacket* packets, size_t count, const udp::endpoint& to,
+            std::shared_ptr<const void> owner = nullptr);
+  // 关闭 socket 之前调用，把排队中的异步发送提交给内核
+  void flush();
+  // 强制使用某种方式，比如排查问题时退回逐包发送
+  void setMode(Mode mode);
+  Mode mode() const { return mode_; }
+  uint64_t syscalls() const { return syscalls_; }
+  uint64_t packets() const { return packets_; }
+  uint64_t dropped() const { return dropped_; }
+
+ private:
+  // 以下函数返回已处理（发出或丢弃）的包数，需要退回逐包发送时提前返回
+  size_t sendBatch(const RTPPacket* packets, size_t count,
+                   const udp::endpoint& to);
+  size_t sendPlain(const RTPPacket* packets, size_t count,
+                   const udp::endpoint& to);
+  void probeGso();
+
+  udp::socket& socket_;
+  Mode mode_ = Mode::GSO;
+  bool probed_ = false;
+  uint64_t syscalls_ = 0;
+  uint64_t packets_ = 0;
+  uint64_t dropped_ = 0;
+#ifdef __linux__
+  UDPMessages messages_;  // 复用的 sendmmsg 参数
+#endif
+  UringService* uring_ = nullptr;  // 不可用或未启用时为空
+};
+
+// RTP over RTSP（RFC 2326 10.12）：RTP/RTCP 包加上 4 字节的 $ 头，与 RTSP 消息共用一条 TCP 连接
+// 所有写操作排队串行执行，每帧的包合成一次 async_write；
+// 积压超过上限时丢弃新帧直到下一个关键帧，慢速客户端不会让内存无限增长
+class TCPInterleavedSender {
+ public:
+  TCPInterleavedSender(tcp::socket& socket, size_t max_queue_bytes)
+      : socket_(socket), max_queue_bytes_(max_queue_bytes) {}
+  // 异步写的回调持有 owner（会话），保证写完之前 socket 和本对象有效
+  void setOwner(const std::shared_ptr<void>& owner) { owner_ = owner; }
+  // RTSP 回复不受积压上限限制；close_after 为 true 时写完后关闭连接
+  void sendText(std::string_view text, bool close_after = false);
+  // packets 的负载由 owner 持有
+  void sendFrame(const std::vector<RTPPacket>& packets, uint8_t channel,
+                 bool is_key, std::shared_ptr<const void> owner);
+  // 单个 RTCP 包等小数据，拷贝后排队，不受积压上限限制
+  void sendInterleaved(uint8_t channel, const uint8_t* data, size_t size);
+  uint64_t droppedFrames() const { return dropped_frames_; }
+
+ private:
+  struct Item {
+    std::string text;
+    std::vector<RTPPacket> packets;
+    std::vector<std::array<uint8_t, 4>> prefixes;  // 每个包的 $ 头
+    std::shared_ptr<const void> owner;
+    size_t bytes = 0;
+    bool close_after = false;
+  };
+  std::unique_ptr<Item> takeItem();
+  void push(std::unique_ptr<Item> item);
+  void writeNext();
+
+  tcp::socket& socket_;
+  size_t max_queue_bytes_;
+  std::weak_ptr<void> owner_;
+  std::deque<std::unique_ptr<Item>> queue_;
+  std::vector<std::unique_ptr<Item>> free_items_;  // 复用，稳定后不再分配
+  std::vector<boost::asio::const_buffer> buffers_;
+  size_t queued_bytes_ = 0;
+  bool writing_ = false;
+  bool waiting_key_ = false;
+  uint64_t dropped_frames_ = 0;
+};
@@ -0,0 +1,153 @@
+#include "sdp.h"
+
+#include <cstdio>
+
+#include "RTCP.h"
+#include "config.h"
+
+namespace {
+std::string base64(const uint8_t* data, size_t size) {
+  static const char kTable[] =
+      "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+  std::string out;
+  out.reserve((size + 2) / 3 * 4);
+  size_t i = 0;
+  for (; i + 2 < size; i += 3) {
+    uint32_t v = (data[i] << 16) | (data[i + 1] << 8) | data[i + 2];
+    out.push_back(kTable[(v >> 18) & 0x3F]);
+    out.push_back(kTable[(v >> 12) & 0x3F]);
+    out.push_back(kTable[(v >> 6) & 0x3F]);
+    out.push_back(kTable[v & 0x3F]);
+  }
+  if (i < size) {
+    uint32_t v = data[i] << 16;
+    if (i + 1 < size) {
+      v |= data[i + 1] << 8;
+    }
+    out.push_back(kTable[(v >> 18) & 0x3F]);
+    out.push_back(kTable[(v >> 12) & 0x3F]);
+    out.push_back(i + 1 < size ? kTable[(v >> 6) & 0x3F] : '=');
+    out.push_back('=');
+  }
+  return out;
+}
+}  // namespace
+
+std::string generateSDP(const MediaSource& source) {
+  // 参数集一般就在文件开头，每种取第一个
+  ParameterSetTypes types = parameterSetTypes(source.codec());
+  NaluView params[3];
+  size_t found = 0;
+  for (size_t i = 0; i < source.naluCount() && found < types.count; ++i) {
+    uint8_t type = source.naluInfo(i).type;
+    for (size_t j = 0; j < types.count; ++j) {
+      if (type == types.types[j] && params[j].empty()) {
+        params[j] = source.nalu(i);
+        ++found;
+      }
+    }
+  }
+
+  std::string sdp;
+  sdp.append("v=0\r\n");
+  // sess-id 用生成时刻的 NTP 秒数，文件变化后重新生成时随之变化
+  sdp.append("o=- ")
+      .append(std::to_string(ntpNow() >> 32))
+      .append(" 1 IN IP4 127.0.0.1\r\n");
+  sdp.append("s=Simple RTSP Server\r\n");
+  sdp.append("c=IN IP4 0.0.0.0\r\n");
+  sdp.append("t=0 0\r\n");
+
+  const std::string pt = std::to_string(kVideoPayloadType);
+  sdp.append("m=video 0 RTP/AVP ").append(pt).append("\r\n");
+  if (source.codec() == CodecId::H265) {
+    // 视频轨道  H.265（RFC 7798 7.1）
+    const NaluView& vps = params[0];
+    const NaluView& sps = params[1];
+    const NaluView& pps = params[2];
+    sdp.append("a=rtpmap:").append(pt).append(" H265/90000\r\n");
+    sdp.append("a=fmtp:").append(pt).append(" ");
+    bool first = true;
+    auto append_param = [&sdp, &first](const char* name, const NaluView& nalu) {
+      if (nalu.empty()) {
+        return;
+      }
+      sdp.append(first ? "" : ";").append(name).append("=").append(
+          base64(nalu.data, nalu.size));
+      first = false;
+    };
+    append_param("sprop-vps", vps);
+    append_param("sprop-sps", sps);
+    append_param("sprop-pps", pps);
+    sdp.append("\r\n");
+  } else {
+    // 视频轨道  H.264
+    const NaluView& sps = params[0];
+    const NaluView& pps = params[1];
+    sdp.append("a=rtpmap:").append(pt).append(" H264/90000\r\n");
+    // 非交错模式：允许 STAP-A 聚合包和 FU-A 分片
+    sdp.append("a=fmtp:").append(pt).append(" packetization-mode=1");
+    // SPS 的第 1~3 字节为 profile_idc、constraint flags、level_idc
+    if (sps.size >= 4) {
+      char profile[7];
+      snprintf(profile, sizeof(profile), "%02X%02X%02X", sps.data[1],
+               sps.data[2], sps.data[3]);
+      sdp.append(";profile-level-id=").append(profile);
+    }
+    if (!sps.empty() && !pps.empty()) {
+      sdp.append(";sprop-parameter-sets=")
+          .append(base64(sps.data, sps.size))
+          .append(",")
+          .append(base64(pps.data, pps.size));
+    }
+    sdp.append("\r\n");
+  }
+  sdp.append("a=control:track0\r\n");
+
+  // 音频轨道，直播模式只转发视频
+  const auto& audio = source.audio();
+  if (!audio || ServerConfig::GetInstance()->broadcast) {
+    return sdp;
+  }
+  char line[128];
+  if (audio->codec() == CodecId::AAC) {
+    // RFC 3640 AAC-hbr，config 为 AudioSpecificConfig 的十六进制
+    sdp.append("m=audio 0 RTP/AVP 97\r\n");
+    snprintf(line, sizeof(line), "a=rtpmap:97 MPEG4-GENERIC/%u/%u\r\n",
+             audio->clockRate(), audio->channels());
+    sdp.append(line);
+    sdp.append(
+        "a=fmtp:97 streamtype=5;profile-level-id=15;mode=AAC-hbr;"
+        "sizelength=13;indexlength=3;indexdeltalength=3;config=");
+    for (size_t i = 0; i < audio->configSize(); ++i) {
+      snprintf(line, sizeof(line), "%02X", audio->config()[i]);
+      sdp.append(line);
+    }
+    sdp.append("\r\n");
+  } else {
+    // G.711 是静态负载类型：PCMU 0，PCMA 8
+    int pt = static_cast<int>(audio->codec());
+    snprintf(line, sizeof(line),
+             "m=audio 0 RTP/AVP %d\r\na=rtpmap:%d %s/8000\r\n", pt, pt,
+             audio->codec() == CodecId::PCMA ? "PCMA" : "PCMU");
+    sdp.append(line);
+  }
+  sdp.append("a=control:track1\r\n");
+  return sdp;
+}
+
+std::shared_ptr<const std::string> SDPCache::get(
+    const std::shared_ptr<const MediaSource>& source) {
+  std::lock_guard<std::mutex> lock(mtx_);
+  Entry& entry = entries_[source->path()];
+  if (!entry.sdp || entry.source.lock() != source) {
+    entry.source = source;
+    entry.sdp = std::make_shared<const std::string>(generateSDP(*source));
+  }
+  return entry.sdp;
+}
+
+void SDPCache::erase(const std::string& path) {
+  std::lock_guard<std::mutex> lock(mtx_);
+  entries_.erase(path);
+}
@@ -0,0 +1,33 @@
+#pragma once
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+#include "mediafile.h"
+#include "singleton.h"
+
+// 根据媒体源生成 SDP，sprop-parameter-sets 和 profile-level-id 取自码流中第一组 SPS/PPS
+// 视频为 track0，有同名音频文件时再加一路 track1
+std::string generateSDP(const MediaSource& source);
+
+// 按挂载点（媒体路径）缓存 SDP，DESCRIBE 只需拷贝缓存的字符串
+// 媒体源换成了新的实例（文件被替换后重新打开）时才重新生成
+class SDPCache : public Singleton<SDPCache> {
+  friend class Singleton<SDPCache>;
+
+ public:
+  std::shared_ptr<const std::string> get(
+      const std::shared_ptr<const MediaSource>& source);
+  void erase(const std::string& path);
+
+ private:
+  SDPCache() = default;
+
+  struct Entry {
+    std::weak_ptr<const MediaSource> source;
+    std::shared_ptr<const std::string> sdp;
+  };
+  std::mutex mtx_;
+  std::unordered_map<std::string, Entry> entries_;
+};
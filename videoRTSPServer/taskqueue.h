@@ -1,36 +1,98 @@
 #pragma once
+#include <atomic>
 #include <cstddef>
-#include <mutex>
-#include <queue>
+#include <cstdint>
+#include <memory>
 
+// 有界无锁 MPMC 队列（Vyukov）：每个槽位带一个序号，生产者/消费者各自 CAS 推进位置，
+// 序号表示槽位当前轮到谁，槽位内的数据不会被同时读写；满了 enqueue 返回 false
+// T 需要可默认构造、可移动赋值
 template <typename T>
 class TaskQueue {
  public:
-  TaskQueue() = default;
-  ~TaskQueue() = default;
-  bool empty() {
-    std::lock_guard<std::mutex> lock(mtx_);
-    return queue_.empty();
+  // 容量向上取整到 2 的幂
+  explicit TaskQueue(size_t capacity = 4096) {
+    size_t size = 2;
+    while (size < capacity) {
+      size <<= 1;
+    }
+    mask_ = size - 1;
+    cells_.reset(new Cell[size]);
+    for (size_t i = 0; i < size; ++i) {
+      cells_[i].sequence.store(i, std::memory_order_relaxed);
+    }
   }
-  size_t size() {
-    std::lock_guard<std::mutex> lock(mtx_);
-    return queue_.size();
+  ~TaskQueue() = default;
+  TaskQueue(const TaskQueue&) = delete;
+  TaskQueue& operator=(const TaskQueue&) = delete;
+
+  // 以下两个在并发时只是近似值
+  bool empty() const { return size() == 0; }
+  size_t size() const {
+    size_t tail = enqueue_pos_.load(std::memory_order_acquire);
+    size_t head = dequeue_pos_.load(std::memory_order_acquire);
+    return tail > head ? tail - head : 0;
   }
-  void enqueue(const T& item) {
-    std::lock_guard<std::mutex> lock(mtx_);
-    queue_.emplace(item);
+  size_t capacity() const { return mask_ + 1; }
+
+  bool enqueue(T&& item) {
+    size_t pos = enqueue_pos_.load(std::memory_order_relaxed);
+    Cell* cell;
+    while (true) {
+      cell = &cells_[pos & mask_];
+      size_t seq = cell->sequence.load(std::memory_order_acquire);
+      intptr_t diff = static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos);
+      if (diff == 0) {
+        if (enqueue_pos_.compare_exchange_weak(pos, pos + 1,
+                                               std::memory_order_relaxed)) {
+          break;
+        }
+      } else if (diff < 0) {
+        // 消费者还没取走上一轮的数据，队列满
+        return false;
+      } else {
+        pos = enqueue_pos_.load(std::memory_order_relaxed);
+      }
+    }
+    cell->data = std::move(item);
+    cell->sequence.store(pos + 1, std::memory_order_release);
+    return true;
   }
   bool dequeue(T& item) {
-    std::lock_guard<std::mutex> lock(mtx_);
-    if (queue_.empty()) {
-      return false;
+    size_t pos = dequeue_pos_.load(std::memory_order_relaxed);
+    Cell* cell;
+    while (true) {
+      cell = &cells_[pos & mask_];
+      size_t seq = cell->sequence.load(std::memory_order_acquire);
+      intptr_t diff =
+          static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos + 1);
+      if (diff == 0) {
+        if (dequeue_pos_.compare_exchange_weak(pos, pos + 1,
+                                               std::memory_order_relaxed)) {
+          break;
+        }
+      } else if (diff < 0) {
+        // 生产者还没写入，队列空
+        return false;
+      } else {
+        pos = dequeue_pos_.load(std::memory_order_relaxed);
+      }
     }
-    item = std::move(queue_.front());
-    queue_.pop();
+    item = std::move(cell->data);
+    // 取走后把槽位留给下一轮的生产者
+    cell->sequence.store(pos + mask_ + 1, std::memory_order_release);
     return true;
   }
 
  private:
-  std::queue<T> queue_;
-  std::mutex mtx_;
+  struct Cell {
+    std::atomic<size_t> sequence;
+    T data;
+  };
+
+  std::unique_ptr<Cell[]> cells_;
+  size_t mask_ = 0;
+  // 生产者和消费者的位置分开放在不同的缓存行，避免伪共享
+  alignas(64) std::atomic<size_t> enqueue_pos_{0};
+  alignas(64) std::atomic<size_t> dequeue_pos_{0};
 };
@@ -1,90 +1,273 @@
 #pragma once
+#include <atomic>
 #include <condition_variable>
-#include <functional>
+#include <cstddef>
+#include <deque>
 #include <future>
 #include <memory>
 #include <mutex>
+#include <new>
 #include <thread>
+#include <tuple>
+#include <type_traits>
+#include <utility>
 #include <vector>
 
 #include "singleton.h"
 #include "taskqueue.h"
 
+// 只能移动的 void() 任务，小的可调用对象直接放在对象内部，不用堆分配；
+// 超过 kInlineSize 或移动可能抛异常的才放到堆上
+class Task {
+ public:
+  static constexpr size_t kInlineSize = 48;
+
+  Task() = default;
+  template <typename F, typename = std::enable_if_t<
+                            !std::is_same_v<std::decay_t<F>, Task>>>
+  Task(F&& f) {  // NOLINT(google-explicit-constructor)
+    using Fn = std::decay_t<F>;
+    if constexpr (sizeof(Fn) <= kInlineSize &&
+                  alignof(Fn) <= alignof(std::max_align_t) &&
+                  std::is_nothrow_move_constructible_v<Fn>) {
+      new (storage_) Fn(std::forward<F>(f));
+      ops_ = &kInlineOps<Fn>;
+    } else {
+      *reinterpret_cast<Fn**>(storage_) = new Fn(std::forward<F>(f));
+      ops_ = &kHeapOps<Fn>;
+    }
+  }
+  Task(Task&& other) noexcept { moveFrom(other); }
+  Task& operator=(Task&& other) noexcept {
+    if (this != &other) {
+      reset();
+      moveFrom(other);
+    }
+    return *this;
+  }
+  Task(const Task&) = delete;
+  Task& operator=(const Task&) = delete;
+  ~Task() { reset(); }
+
+  explicit operator bool() const { return ops_ != nullptr; }
+  void operator()() { ops_->invoke(storage_); }
+  void reset() {
+    if (ops_ != nullptr) {
+      ops_->destroy(storage_);
+      ops_ = nullptr;
+    }
+  }
+
+ private:
+  struct Ops {
+    void (*invoke)(void* storage);
+    // 把 src 中的对象移动到 dst 并销毁 src 中的对象
+    void (*move)(void* dst, void* src);
+    void (*destroy)(void* storage);
+  };
+  template <typename Fn>
+  static constexpr Ops kInlineOps = {
+      [](void* storage) { (*static_cast<Fn*>(storage))(); },
+      [](void* dst, void* src) {
+        new (dst) Fn(std::move(*static_cast<Fn*>(src)));
+        static_cast<Fn*>(src)->~Fn();
+      },
+      [](void* storage) { static_cast<Fn*>(storage)->~Fn(); }};
+  template <typename Fn>
+  static constexpr Ops kHeapOps = {
+      [](void* storage) { (**static_cast<Fn**>(storage))(); },
+      [](void* dst, void* src) {
+        *static_cast<Fn**>(dst) = *static_cast<Fn**>(src);
+      },
+      [](void* storage) { delete *static_cast<Fn**>(storage); }};
+
+  void moveFrom(Task& other) {
+    if (other.ops_ != nullptr) {
+      other.ops_->move(storage_, other.storage_);
+      ops_ = other.ops_;
+      other.ops_ = nullptr;
+    }
+  }
+
+  alignas(std::max_align_t) unsigned char storage_[kInlineSize];
+  const Ops* ops_ = nullptr;
+};
+
+// 工作窃取线程池：
+// - 外部线程提交的任务进入有界无锁的注入队列 tasks_，满了就让出 CPU 重试（反压）
+// - 工作线程里提交的任务（任务再派生的任务）放进自己的本地队列，后进先出，缓存热
+// - 空闲的工作线程依次从本地队列、注入队列、其它线程的本地队列（先进先出地偷）取任务，
+//   都没有时先自旋几轮，再睡在条件变量上；只有确实有线程在睡时提交方才去唤醒
 class ThreadPool : public Singleton<ThreadPool> {
  public:
   friend class Singleton<ThreadPool>;
   // return future<type of f>, res.get() to get result
+  // f 和 args 按值保存（移动进来），结果的共享状态是唯一的一次堆分配
   template <typename F, typename... Args>
-  auto submit(F&& f, Args&&... args) -> std::future<decltype(f(args...))> {
-    using func_type = decltype(f(args...))();
-    // bind function and its args to get future result
-    auto task_ptr = std::make_shared<std::packaged_task<func_type>>(
-        [f, args...]() { return f(args...); });
-    // wrap packaged task to be uniformed void() to fit in task queue
-    std::function<void()> wrapper_func = [task_ptr]() { (*task_ptr)(); };
-    tasks_.enqueue(wrapper_func);
-    // notify one worker to process task
-    condition_lock_.notify_one();
-    return task_ptr->get_future();
+  auto submit(F&& f, Args&&... args)
+      -> std::future<std::invoke_result_t<std::decay_t<F>,
+                                          std::decay_t<Args>...>> {
+    using result_type =
+        std::invoke_result_t<std::decay_t<F>, std::decay_t<Args>...>;
+    std::packaged_task<result_type()> task(
+        [f = std::forward<F>(f),
+         args = std::make_tuple(std::forward<Args>(args)...)]() mutable {
+          return std::apply(std::move(f), std::move(args));
+        });
+    std::future<result_type> future = task.get_future();
+    post(std::move(task));
+    return future;
+  }
+  // 不需要结果的任务，可调用对象足够小时完全不分配内存
+  template <typename F>
+  void post(F&& f) {
+    Task task(std::forward<F>(f));
+    Worker* self = current_worker_;
+    if (self != nullptr && self->pool == this) {
+      std::lock_guard<std::mutex> lock(self->mtx);
+      self->local.push_back(std::move(task));
+      self->local_size.fetch_add(1, std::memory_order_release);
+    } else {
+      while (!tasks_.enqueue(std::move(task))) {
+        std::this_thread::yield();
+      }
+    }
+    wakeOne();
   }
+  size_t workerCount() const { return workers_.size(); }
   void shutdown() {
-    if (shutdown_) {
+    if (shutdown_.exchange(true)) {
       return;
     }
-    shutdown_ = true;
-    // notify all worker to exit
-    condition_lock_.notify_all();
+    // notify all worker to exit, 已经提交的任务会先执行完
+    {
+      std::lock_guard<std::mutex> lock(sleep_mtx_);
+      sleep_cv_.notify_all();
+    }
     for (auto& worker : workers_) {
-      if (worker.joinable()) {
-        worker.join();
+      if (worker->thread.joinable()) {
+        worker->thread.join();
       }
     }
   }
-  ~ThreadPool() {
-    if (!shutdown_) {
-      shutdown();
-    }
-  }
+  ~ThreadPool() { shutdown(); }
 
  private:
-  TaskQueue<std::function<void()>> tasks_;
-  std::vector<std::thread> workers_;
-  bool shutdown_;
-  std::mutex mtx_;
-  std::condition_variable condition_lock_;
-
-  ThreadPool(size_t numThreads = 6) : shutdown_(false), workers_(numThreads) {
-    init();
-  }
+  // 每个工作线程一个，独占缓存行；本地队列只在被偷时才有竞争
+  struct alignas(64) Worker {
+    ThreadPool* pool = nullptr;
+    std::thread thread;
+    std::mutex mtx;
+    std::deque<Task> local;
+    std::atomic<size_t> local_size{0};
+  };
+  // 找不到任务时先自旋这么多轮再睡
+  static constexpr int kSpinRounds = 64;
+
+  TaskQueue<Task> tasks_;
+  std::vector<std::unique_ptr<Worker>> workers_;
+  std::atomic<bool> shutdown_{false};
+  std::atomic<size_t> sleepers_{0};
+  std::mutex sleep_mtx_;
+  std::condition_variable sleep_cv_;
+  static inline thread_local Worker* current_worker_ = nullptr;
 
-  
+  ThreadPool(size_t numThreads = 6) { init(numThreads); }
 
   // 6 cores thread pool
-  void init() {
-    for (size_t i = 0; i < workers_.size(); ++i) {
-      workers_[i] = std::thread([this, i]() {
-        std::function<void()> func;
-        bool dequeued = false;
-        while (!shutdown_) {
-          // create a new block to fetch task
-          // to avoid holding lock while executing task
-          {
-            std::unique_lock<std::mutex> lcok(mtx_);
-            if (tasks_.empty()) {
-              // wait until there is a task or shutdown signal
-              condition_lock_.wait(
-                  lcok, [this]() { return shutdown_ || !tasks_.empty(); });
-            }
-            if (shutdown_ && tasks_.empty()) {
-              return;
-            }
-            dequeued = tasks_.dequeue(func);
-          }
-          if (dequeued) {
-            func();
-          }
-        }
+  void init(size_t numThreads) {
+    for (size_t i = 0; i < numThreads; ++i) {
+      workers_.push_back(std::make_unique<Worker>());
+      workers_.back()->pool = this;
+    }
+    for (size_t i = 0; i < numThreads; ++i) {
+      workers_[i]->thread = std::thread([this, i]() { run(i); });
+    }
+  }
+
+  void run(size_t index) {
+    Worker& self = *workers_[index];
+    current_worker_ = &self;
+    Task task;
+    int idle_rounds = 0;
+    while (true) {
+      if (popLocal(self, task) || tasks_.dequeue(task) ||
+          steal(index, task)) {
+        task();
+        task.reset();
+        idle_rounds = 0;
+        continue;
+      }
+      if (++idle_rounds < kSpinRounds) {
+        std::this_thread::yield();
+        continue;
+      }
+      idle_rounds = 0;
+      std::unique_lock<std::mutex> lock(sleep_mtx_);
+      // 先登记再检查，与 wakeOne 中先入队再读 sleepers_ 配对，不会丢失唤醒
+      sleepers_.fetch_add(1, std::memory_order_seq_cst);
+      std::atomic_thread_fence(std::memory_order_seq_cst);
+      sleep_cv_.wait(lock, [this]() {
+        return shutdown_.load(std::memory_order_acquire) || hasWork();
       });
+      sleepers_.fetch_sub(1, std::memory_order_relaxed);
+      if (shutdown_.load(std::memory_order_acquire) && !hasWork()) {
+        return;
+      }
+    }
+  }
+
+  bool popLocal(Worker& self, Task& task) {
+    if (self.local_size.load(std::memory_order_acquire) == 0) {
+      return false;
+    }
+    std::lock_guard<std::mutex> lock(self.mtx);
+    if (self.local.empty()) {
+      return false;
+    }
+    task = std::move(self.local.back());
+    self.local.pop_back();
+    self.local_size.fetch_sub(1, std::memory_order_relaxed);
+    return true;
+  }
+
+  // 从 index 之后的线程开始依次偷，每次偷最老的一个
+  bool steal(size_t index, Task& task) {
+    for (size_t n = 1; n < workers_.size(); ++n) {
+      Worker& victim = *workers_[(index + n) % workers_.size()];
+      if (victim.local_size.load(std::memory_order_acquire) == 0) {
+        continue;
+      }
+      std::unique_lock<std::mutex> lock(victim.mtx, std::try_to_lock);
+      if (!lock.owns_lock() || victim.local.empty()) {
+        continue;
+      }
+      task = std::move(victim.local.front());
+      victim.local.pop_front();
+      victim.local_size.fetch_sub(1, std::memory_order_relaxed);
+      return true;
+    }
+    return false;
+  }
+
+  bool hasWork() const {
+    if (!tasks_.empty()) {
+      return true;
+    }
+    for (const auto& worker : workers_) {
+      if (worker->local_size.load(std::memory_order_acquire) != 0) {
+        return true;
+      }
+    }
+    return false;
+  }
+
+  void wakeOne() {
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (sleepers_.load(std::memory_order_seq_cst) == 0) {
+      return;
     }
+    std::lock_guard<std::mutex> lock(sleep_mtx_);
+    sleep_cv_.notify_one();
   }
 };
@@ -0,0 +1,272 @@
+#ifdef USE_IO_URING
+#include "uring.h"
+
+#include <sys/eventfd.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <iostream>
+
+#include "metrics.h"
+
+// 直接用系统调用和内核头文件，不依赖 liburing
+namespace {
+int uringSetup(unsigned entries, io_uring_params* params) {
+  return static_cast<int>(syscall(__NR_io_uring_setup, entries, params));
+}
+int uringEnter(int fd, unsigned to_submit) {
+  return static_cast<int>(
+      syscall(__NR_io_uring_enter, fd, to_submit, 0, 0, nullptr, 0));
+}
+int uringRegister(int fd, unsigned opcode, const void* arg, unsigned count) {
+  return static_cast<int>(
+      syscall(__NR_io_uring_register, fd, opcode, arg, count));
+}
+template <typename T>
+T* ringField(void* ring, uint32_t offset) {
+  return reinterpret_cast<T*>(static_cast<char*>(ring) + offset);
+}
+}  // namespace
+
+net::execution_context::id UringService::id;
+
+UringService::UringService(net::execution_context& context)
+    : net::execution_context::service(context),
+      ioc_(static_cast<net::io_context&>(context)),
+      event_(ioc_) {
+  if (setupRing(kEntries)) {
+    waitEvent();
+  } else {
+    closeRing();
+  }
+}
+
+UringService::~UringService() { closeRing(); }
+
+void UringService::shutdown() {
+  boost::system::error_code ec;
+  event_.close(ec);
+}
+
+bool UringService::setupRing(unsigned entries) {
+  io_uring_params params;
+  memset(&params, 0, sizeof(params));
+  ring_fd_ = uringSetup(entries, &params);
+  if (ring_fd_ < 0) {
+    std::cerr << "io_uring unavailable: " << strerror(errno)
+              << ", use sendmmsg" << std::endl;
+    return false;
+  }
+  sq_ring_size_ = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+  cq_ring_size_ =
+      params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+  bool single_mmap = params.features & IORING_FEAT_SINGLE_MMAP;
+  if (single_mmap) {
+    sq_ring_size_ = cq_ring_size_ = std::max(sq_ring_size_, cq_ring_size_);
+  }
+  sq_ring_ = mmap(nullptr, sq_ring_size_, PROT_READ | PROT_WRITE,
+                  MAP_SHARED | MAP_POPULATE, ring_fd_, IORING_OFF_SQ_RING);
+  if (sq_ring_ == MAP_FAILED) {
+    sq_ring_ = nullptr;
+    return false;
+  }
+  if (single_mmap) {
+    cq_ring_ = sq_ring_;
+  } else {
+    cq_ring_ = mmap(nullptr, cq_ring_size_, PROT_READ | PROT_WRITE,
+                    MAP_SHARED | MAP_POPULATE, ring_fd_, IORING_OFF_CQ_RING);
+    if (cq_ring_ == MAP_FAILED) {
+      cq_ring_ = nullptr;
+      return false;
+    }
+  }
+  sqes_size_ = params.sq_entries * sizeof(io_uring_sqe);
+  void* sqes = mmap(nullptr, sqes_size_, PROT_READ | PROT_WRITE,
+                    MAP_SHARED | MAP_POPULATE, ring_fd_, IORING_OFF_SQES);
+  if (sqes == MAP_FAILED) {
+    return false;
+  }
+  sqes_ = static_cast<io_uring_sqe*>(sqes);
+  sq_entries_ = params.sq_entries;
+  sq_head_ = ringField<unsigned>(sq_ring_, params.sq_off.head);
+  sq_tail_ = ringField<unsigned>(sq_ring_, params.sq_off.tail);
+  sq_mask_ = *ringField<unsigned>(sq_ring_, params.sq_off.ring_mask);
+  sq_array_ = ringField<unsigned>(sq_ring_, params.sq_off.array);
+  cq_head_ = ringField<unsigned>(cq_ring_, params.cq_off.head);
+  cq_tail_ = ringField<unsigned>(cq_ring_, params.cq_off.tail);
+  cq_mask_ = *ringField<unsigned>(cq_ring_, params.cq_off.ring_mask);
+  cqes_ = ringField<io_uring_cqe>(cq_ring_, params.cq_off.cqes);
+
+  // 完成事件写 eventfd，由 io_context 监听，不需要单独的线程等待
+  event_fd_ = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+  if (event_fd_ < 0 ||
+      uringRegister(ring_fd_, IORING_REGISTER_EVENTFD, &event_fd_, 1) < 0) {
+    std::cerr << "io_uring eventfd failed: " << strerror(errno)
+              << ", use sendmmsg" << std::endl;
+    if (event_fd_ >= 0) {
+      ::close(event_fd_);
+      event_fd_ = -1;
+    }
+    return false;
+  }
+  event_.assign(event_fd_);
+  std::cout << "io_uring enabled, " << sq_entries_ << " entries" << std::endl;
+  return true;
+}
+
+void UringService::closeRing() {
+  // 先关闭 ring，内核结束在途的请求后才释放它们引用的内存
+  if (ring_fd_ >= 0) {
+    ::close(ring_fd_);
+    ring_fd_ = -1;
+  }
+  if (sqes_ != nullptr) {
+    munmap(sqes_, sqes_size_);
+    sqes_ = nullptr;
+  }
+  if (cq_ring_ != nullptr && cq_ring_ != sq_ring_) {
+    munmap(cq_ring_, cq_ring_size_);
+  }
+  cq_ring_ = nullptr;
+  if (sq_ring_ != nullptr) {
+    munmap(sq_ring_, sq_ring_size_);
+    sq_ring_ = nullptr;
+  }
+  boost::system::error_code ec;
+  event_.close(ec);
+  event_fd_ = -1;
+}
+
+bool UringService::send(int fd, const RTPPacket* packets, size_t count,
+                        const udp::endpoint& to, bool gso,
+                        std::shared_ptr<const void> owner) {
+  if (!available()) {
+    return false;
+  }
+  Batch* batch;
+  if (free_batches_.empty()) {
+    batches_.push_back(std::make_unique<Batch>());
+    batch = batches_.back().get();
+  } else {
+    batch = free_batches_.back();
+    free_batches_.pop_back();
+  }
+  // 包头在包对象内，调用方会复用，拷贝一份；负载只是指针
+  batch->packets.assign(packets, packets + count);
+  batch->to = to;
+  batch->messages.build(batch->packets.data(), count, batch->to,
+                        gso && !gso_disabled_);
+  std::vector<mmsghdr>& msgs = batch->messages.msgs;
+
+  if (inflight_ + msgs.size() > kMaxInflight) {
+    reap();
+  }
+  unsigned tail = *sq_tail_;
+  if (tail - __atomic_load_n(sq_head_, __ATOMIC_ACQUIRE) + msgs.size() >
+      sq_entries_) {
+    flush();
+    tail = *sq_tail_;
+  }
+  if (inflight_ + msgs.size() > kMaxInflight ||
+      tail - __atomic_load_n(sq_head_, __ATOMIC_ACQUIRE) + msgs.size() >
+          sq_entries_) {
+    free_batches_.push_back(batch);
+    return false;
+  }
+  for (mmsghdr& msg : msgs) {
+    unsigned index = tail & sq_mask_;
+    io_uring_sqe* sqe = &sqes_[index];
+    memset(sqe, 0, sizeof(*sqe));
+    sqe->opcode = IORING_OP_SENDMSG;
+    sqe->fd = fd;
+    sqe->addr = reinterpret_cast<uint64_t>(&msg.msg_hdr);
+    sqe->len = 1;
+    sqe->user_data = reinterpret_cast<uint64_t>(batch);
+    sq_array_[index] = index;
+    ++tail;
+  }
+  __atomic_store_n(sq_tail_, tail, __ATOMIC_RELEASE);
+  to_submit_ += msgs.size();
+  inflight_ += msgs.size();
+  batch->pending = msgs.size();
+  batch->owner = std::move(owner);
+  Metrics::GetInstance()->io_uring_sqes += msgs.size();
+  scheduleFlush();
+  return true;
+}
+
+void UringService::scheduleFlush() {
+  if (flush_posted_) {
+    return;
+  }
+  flush_posted_ = true;
+  // 当前这一轮就绪的处理函数都执行完后再提交，多个会话合并为一次系统调用
+  net::post(ioc_, [this]() {
+    flush_posted_ = false;
+    flush();
+  });
+}
+
+void UringService::flush() {
+  if (to_submit_ > 0 && available()) {
+    Metrics::GetInstance()->io_uring_enter_calls++;
+    int ret = uringEnter(ring_fd_, to_submit_);
+    if (ret >= 0) {
+      to_submit_ -= std::min<unsigned>(ret, to_submit_);
+    } else if (errno != EINTR && errno != EAGAIN && errno != EBUSY) {
+      std::cerr << "io_uring_enter failed: " << strerror(errno) << std::endl;
+    }
+    if (to_submit_ > 0) {
+      // 内核暂时处理不了，下一轮再提交
+      scheduleFlush();
+    }
+  }
+  reap();
+}
+
+void UringService::reap() {
+  if (!available()) {
+    return;
+  }
+  unsigned head = *cq_head_;
+  unsigned tail = __atomic_load_n(cq_tail_, __ATOMIC_ACQUIRE);
+  while (head != tail) {
+    const io_uring_cqe& cqe = cqes_[head & cq_mask_];
+    Batch* batch = reinterpret_cast<Batch*>(cqe.user_data);
+    if (cqe.res < 0) {
+      Metrics::GetInstance()->io_uring_send_errors++;
+      int error = -cqe.res;
+      if (!gso_disabled_ && (error == EIO || error == EINVAL ||
+                             error == ENOPROTOOPT || error == EOPNOTSUPP)) {
+        // 与同步发送一样，网卡或路由不支持分段卸载时关掉 GSO
+        std::cerr << "UDP GSO failed: " << strerror(error)
+                  << ", io_uring sends without GSO" << std::endl;
+        gso_disabled_ = true;
+      }
+    }
+    --inflight_;
+    if (--batch->pending == 0) {
+      batch->owner.reset();
+      free_batches_.push_back(batch);
+    }
+    ++head;
+  }
+  __atomic_store_n(cq_head_, head, __ATOMIC_RELEASE);
+}
+
+void UringService::waitEvent() {
+  event_.async_read_some(
+      net::buffer(&event_value_, sizeof(event_value_)),
+      [this](boost::system::error_code ec, size_t) {
+        if (ec) {
+          return;
+        }
+        reap();
+        waitEvent();
+      });
+}
+#endif
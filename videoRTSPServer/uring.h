@@ -0,0 +1,84 @@
+#pragma once
+#ifdef USE_IO_URING
+#include <linux/io_uring.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "RTP.h"
+#include "global.h"
+#include "rtpsender.h"
+
+// 每个 io_context 一个的 io_uring，异步提交 RTP 报文（IORING_OP_SENDMSG）
+// 同一轮事件循环中各会话交来的报文先排进提交队列，由 post 的 flush 一次 io_uring_enter 提交；
+// 完成事件通过注册的 eventfd 通知到 io_context，回收时才释放包的副本和负载的 owner
+// 内核不支持（或被禁用）时 available() 为 false，发送方退回 sendmmsg
+class UringService : public net::execution_context::service {
+ public:
+  static net::execution_context::id id;
+
+  explicit UringService(net::execution_context& context);
+  ~UringService() override;
+  bool available() const { return ring_fd_ >= 0; }
+  // 拷贝包头、排队发送到 fd，负载由 owner 持有到发送完成；
+  // 提交队列或在途数量已满时返回 false，由调用方同步发送
+  bool send(int fd, const RTPPacket* packets, size_t count,
+            const udp::endpoint& to, bool gso,
+            std::shared_ptr<const void> owner);
+  // 立即提交排队中的报文；关闭 socket 之前必须调用，内核提交时才取得文件引用
+  void flush();
+
+ private:
+  // 一次 send 的报文，在途期间地址不变
+  struct Batch {
+    std::vector<RTPPacket> packets;
+    udp::endpoint to;
+    UDPMessages messages;
+    std::shared_ptr<const void> owner;
+    size_t pending = 0;  // 未完成的报文数
+  };
+
+  void shutdown() override;
+  bool setupRing(unsigned entries);
+  void closeRing();
+  void reap();
+  void waitEvent();
+  void scheduleFlush();
+
+  static constexpr unsigned kEntries = 1024;
+  // 在途报文数上限，保证完成队列（2 倍提交队列）不会溢出
+  static constexpr size_t kMaxInflight = kEntries * 2;
+
+  net::io_context& ioc_;
+  int ring_fd_ = -1;
+  // 提交队列和完成队列的共享内存
+  void* sq_ring_ = nullptr;
+  size_t sq_ring_size_ = 0;
+  void* cq_ring_ = nullptr;
+  size_t cq_ring_size_ = 0;
+  io_uring_sqe* sqes_ = nullptr;
+  size_t sqes_size_ = 0;
+  unsigned sq_entries_ = 0;
+  unsigned* sq_head_ = nullptr;
+  unsigned* sq_tail_ = nullptr;
+  unsigned sq_mask_ = 0;
+  unsigned* sq_array_ = nullptr;
+  unsigned* cq_head_ = nullptr;
+  unsigned* cq_tail_ = nullptr;
+  unsigned cq_mask_ = 0;
+  io_uring_cqe* cqes_ = nullptr;
+
+  unsigned to_submit_ = 0;
+  size_t inflight_ = 0;
+  bool flush_posted_ = false;
+  // GSO 报文被拒绝后，后面的批次不再合并
+  bool gso_disabled_ = false;
+  int event_fd_ = -1;
+  net::posix::stream_descriptor event_;
+  uint64_t event_value_ = 0;
+  std::vector<std::unique_ptr<Batch>> batches_;
+  std::vector<Batch*> free_batches_;  // 复用，稳定后不再分配
+};
+#endif
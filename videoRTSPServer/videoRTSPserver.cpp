@@ -2,8 +2,23 @@
 #include <memory>
 
 #include "RTSPserver.h"
-auto main() -> int {
+#include "asioioservicepool.h"
+#include "config.h"
+#include "mediacatalog.h"
+#include "metrics.h"
+auto main(int argc, char* argv[]) -> int {
   try {
+    // 可选的配置文件路径
+    auto config = ServerConfig::GetInstance();
+    if (argc > 1) {
+      config->load(argv[1]);
+    }
+    auto catalog = MediaCatalog::GetInstance();
+    catalog->setMaxOpen(config->max_open_sources);
+    if (!config->media_dir.empty()) {
+      catalog->scan(config->media_dir);
+    }
+    catalog->add("live", config->media_path);
     net::io_context ioc{1};
     boost::asio::signal_set signals(ioc, SIGINT, SIGTERM);
     signals.async_wait(
@@ -13,7 +28,19 @@ auto main() -> int {
           }
           ioc.stop();
         });
-    std::make_shared<RTSPServer>(ioc, 8554)->start();
+    if (config->reuseport_acceptors) {
+      // 每个网络线程一个监听，连接在哪个线程接受，会话就在哪个线程运行
+      auto pool = AsioIOServicePool::GetInstance();
+      for (size_t i = 0; i < pool->size(); ++i) {
+        std::make_shared<RTSPServer>(pool->GetIOService(i), config->port, true)
+            ->start();
+      }
+    } else {
+      std::make_shared<RTSPServer>(ioc, config->port)->start();
+    }
+    if (config->metrics_port != 0) {
+      std::make_shared<MetricsServer>(ioc, config->metrics_port)->start();
+    }
     ioc.run();
   } catch (std::exception const& e) {
     std::cerr << "Error: " << e.what() << std::endl;